@@ -1,3 +1,3 @@
 gcc -g -Wall code/kaleidoscope.c -o build/kaleidoscope.bin \
-	-I"/usr/include/llvm-c-11" -lLLVM-11 \
+	-I"/usr/include/llvm-c-11" -I"/usr/include/llvm-11" -lLLVM-11 \
 	-Wno-switch -Wno-unused-function
\ No newline at end of file
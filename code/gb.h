@@ -974,6 +974,8 @@ gb_mutex_init(&m);
 
 
 
+struct gbThread;
+
 #define GB_THREAD_PROC(name) isize name(struct gbThread *thread)
 typedef GB_THREAD_PROC(gbThreadProc);
 
@@ -1033,6 +1035,7 @@ typedef struct gbAffinity {
 	isize thread_count;
 	#define GB_WIN32_MAX_THREADS (8 * gb_size_of(usize))
 	usize core_masks[GB_WIN32_MAX_THREADS];
+	usize process_mask;
 
 } gbAffinity;
 
@@ -1046,10 +1049,11 @@ typedef struct gbAffinity {
 
 #elif defined(GB_SYSTEM_LINUX)
 typedef struct gbAffinity {
-	b32   is_accurate;
-	isize core_count;
-	isize thread_count;
-	isize threads_per_core;
+	b32       is_accurate;
+	isize     core_count;
+	isize     thread_count;
+	isize     threads_per_core;
+	cpu_set_t allowed; // NOTE(khvorov) The initializing thread's mask, cores index into it
 } gbAffinity;
 #else
 #error TODO(bill): Unknown system
@@ -1058,6 +1062,7 @@ typedef struct gbAffinity {
 GB_DEF void  gb_affinity_init   (gbAffinity *a);
 GB_DEF void  gb_affinity_destroy(gbAffinity *a);
 GB_DEF b32   gb_affinity_set    (gbAffinity *a, isize core, isize thread);
+GB_DEF b32   gb_affinity_reset  (gbAffinity *a); // NOTE(khvorov) Undoes gb_affinity_set for the calling thread
 GB_DEF isize gb_affinity_thread_count_for_core(gbAffinity *a, isize core);
 
 
@@ -1164,14 +1169,26 @@ GB_DEF GB_ALLOCATOR_PROC(gb_heap_allocator_proc);
 //
 // Arena Allocator
 //
+// NOTE(khvorov) Arenas with a backing allocator chain a new block onto the
+// current one when they run out instead of failing. The sizes and counts are
+// for the current block.
 typedef struct gbArena {
 	gbAllocator backing;
 	void *      physical_start;
 	isize       total_size;
 	isize       total_allocated;
 	isize       temp_count;
+	isize       block_size;
+	isize       block_count;
 } gbArena;
 
+// NOTE(khvorov) Stored at the start of every chained block
+typedef struct gbArenaBlockHeader {
+	void *prev_start;
+	isize prev_size;
+	isize prev_allocated;
+} gbArenaBlockHeader;
+
 GB_DEF void gb_arena_init_from_memory   (gbArena *arena, void *start, isize size);
 GB_DEF void gb_arena_init_from_allocator(gbArena *arena, gbAllocator backing, isize size);
 GB_DEF void gb_arena_init_sub           (gbArena *arena, gbArena *parent_arena, isize size);
@@ -1190,6 +1207,7 @@ GB_DEF GB_ALLOCATOR_PROC(gb_arena_allocator_proc);
 
 typedef struct gbTempArenaMemory {
 	gbArena *arena;
+	void *   original_start;
 	isize    original_count;
 } gbTempArenaMemory;
 
@@ -1623,6 +1641,99 @@ GB_DEF void gb_array_reserve(gbDynamicArray *arr, isize new_capacity);
 GB_DEF void *gb_array_get(gbDynamicArray *arr, isize index);
 GB_DEF void *gb_array_set(gbDynamicArray *arr, isize index, void *value);
 
+// NOTE(khvorov) GB_ARRAY_DEFINE(Type) generates gbArray(Type), a dynamic array
+// that grows like gbDynamicArray but knows its element type, so elements are
+// assigned instead of memcopied and indexing is plain pointer arithmetic. Type
+// has to be a single identifier, typedef it first otherwise.
+#define gbArray(Type) gbArray_##Type
+
+#define GB_ARRAY_DEFINE(Type) \
+typedef struct gbArray(Type) { \
+	Type *      ptr; \
+	isize       len; \
+	isize       cap; \
+	gbAllocator allocator; \
+} gbArray(Type); \
+\
+gb_internal void \
+gb_array_init_##Type(gbArray(Type) *arr, gbAllocator allocator) { \
+	arr->allocator = allocator; \
+	arr->len = 0; \
+	arr->cap = gb_array_grow_formula(0); \
+	arr->ptr = gb_alloc_array(allocator, Type, arr->cap); \
+} \
+\
+gb_internal void \
+gb_array_free_##Type(gbArray(Type) *arr) { \
+	gb_free(arr->allocator, arr->ptr); \
+} \
+\
+gb_internal void \
+gb_array_reserve_##Type(gbArray(Type) *arr, isize new_capacity) { \
+	if (arr->cap < new_capacity) { \
+		Type *new_ptr = gb_alloc_array(arr->allocator, Type, new_capacity); \
+		gb_memcopy(new_ptr, arr->ptr, gb_size_of(Type) * arr->len); \
+		gb_free(arr->allocator, arr->ptr); \
+		arr->ptr = new_ptr; \
+		arr->cap = new_capacity; \
+	} \
+} \
+\
+gb_internal void \
+gb_array_grow_##Type(gbArray(Type) *arr, isize min_capacity) { \
+	gb_array_reserve_##Type(arr, gb_max(gb_array_grow_formula(arr->cap), min_capacity)); \
+} \
+\
+gb_internal Type * \
+gb_array_append_##Type(gbArray(Type) *arr, Type item) { \
+	if (arr->cap < arr->len + 1) { \
+		gb_array_grow_##Type(arr, 0); \
+	} \
+	Type *result = arr->ptr + arr->len; \
+	*result = item; \
+	arr->len += 1; \
+	return result; \
+} \
+\
+gb_internal Type * \
+gb_array_appendv_##Type(gbArray(Type) *arr, Type const *items, isize item_count) { \
+	if (arr->cap < arr->len + item_count) { \
+		gb_array_grow_##Type(arr, arr->len + item_count); \
+	} \
+	Type *result = arr->ptr + arr->len; \
+	gb_memcopy(result, items, gb_size_of(Type) * item_count); \
+	arr->len += item_count; \
+	return result; \
+} \
+\
+gb_internal Type \
+gb_array_pop_##Type(gbArray(Type) *arr) { \
+	GB_ASSERT(arr->len > 0); \
+	arr->len -= 1; \
+	Type result = arr->ptr[arr->len]; \
+	return result; \
+} \
+\
+gb_internal Type * \
+gb_array_last_##Type(gbArray(Type) *arr) { \
+	GB_ASSERT(arr->len > 0); \
+	Type *result = arr->ptr + arr->len - 1; \
+	return result; \
+} \
+\
+gb_internal void \
+gb_array_clear_##Type(gbArray(Type) *arr) { \
+	arr->len = 0; \
+} \
+\
+gb_internal void \
+gb_array_resize_##Type(gbArray(Type) *arr, isize new_count) { \
+	if (arr->cap < new_count) { \
+		gb_array_grow_##Type(arr, new_count); \
+	} \
+	arr->len = new_count; \
+}
+
 //
 // SECTION Hashing and Checksum Functions
 //
@@ -1645,6 +1756,12 @@ GB_EXTERN u64 gb_murmur64(void const *data, isize len);
 GB_EXTERN u32 gb_murmur32_seed(void const *data, isize len, u32 seed);
 GB_EXTERN u64 gb_murmur64_seed(void const *data, isize len, u64 seed);
 
+// NOTE(khvorov) wyhash, reads keys up to 16 bytes with at most four loads and
+// mixes them with a single 64x64->128 multiply. Meant for short keys like
+// identifiers, longer ones go 16 or 48 bytes at a time.
+GB_EXTERN u64 gb_wyhash64(void const *data, isize len);
+GB_EXTERN u64 gb_wyhash64_seed(void const *data, isize len, u64 seed);
+
 
 //
 // SECTION Hash Table
@@ -1653,6 +1770,11 @@ GB_EXTERN u64 gb_murmur64_seed(void const *data, isize len, u64 seed);
 typedef u64 KeyHashProc(void *key);
 typedef b32 KeyCmpProc(void *key1, void *key2);
 
+// NOTE(khvorov) With incremental_rehash set, growing only allocates the new
+// buckets. Every set after that moves the chains of a few old buckets over
+// until none are left, so no single set pays for the whole table. Entries stay
+// where they are either way, only the chains through them change. Gets never
+// move anything so they are still safe to do from several threads at once.
 typedef struct gbHashTable {
 	gbDynamicArray entry_indices;
 	gbDynamicArray entry_headers;
@@ -1660,6 +1782,9 @@ typedef struct gbHashTable {
 	gbDynamicArray entry_values;
 	KeyHashProc*   key_hash_proc;
 	KeyCmpProc*    key_cmp_proc;
+	b32            incremental_rehash;
+	gbDynamicArray old_entry_indices; // NOTE(khvorov) Buckets being moved over, len 0 when not rehashing
+	isize          old_entry_indices_moved; // NOTE(khvorov) Old buckets before this one are empty
 } gbHashTable;
 
 typedef struct gbHashTableEntryHeader {
@@ -1667,11 +1792,16 @@ typedef struct gbHashTableEntryHeader {
 } gbHashTableEntryHeader;
 
 typedef struct gbHashTableFindResult {
+	gbDynamicArray *entry_indices; // NOTE(khvorov) Old or new buckets while rehashing
 	isize entry_index_index;
 	isize entry_prev;
 	isize entry_index;
 } gbHashTableFindResult;
 
+#ifndef GB_HTAB_REHASH_BUCKETS_PER_SET
+#define GB_HTAB_REHASH_BUCKETS_PER_SET 4
+#endif
+
 GB_DEF void gb_htab_init(
 	gbHashTable *htab, gbAllocator allocator, isize key_size, isize value_size,
 	KeyHashProc *key_hash_proc, KeyCmpProc *key_cmp_proc
@@ -1686,6 +1816,381 @@ GB_DEF void                  gb_htab__reset_entry_indices(gbHashTable *htab);
 GB_DEF isize                 gb_htab__add_header(gbHashTable *htab);
 GB_DEF gbHashTableFindResult gb_htab__find(gbHashTable *htab, void *key);
 GB_DEF b32                   gb_htab__full(gbHashTable *htab);
+GB_DEF void                  gb_htab__move_buckets(gbHashTable *htab, isize bucket_count);
+
+//
+// SECTION Flat Hash Table
+//
+
+// NOTE(khvorov) Open addressing over groups of 16 slots. Every slot has a
+// control byte: empty, deleted, or the top 7 bits of the key's hash. A lookup
+// compares the key's 7 bits against a whole group of control bytes at once and
+// only looks at the keys that match. Keys and values sit next to each other in
+// the slots. Keys are compared bytewise unless a compare proc is given.
+//
+// GB_HTAB_DEFINE below generates the same table for fixed key and value
+// types. Both keep their control bytes in a gbFlatHashTableCtrl and probe,
+// claim, erase and grow through the helpers after it, so only comparing keys
+// and copying slots is done by each table itself.
+
+#define GB_FLAT_HTAB_GROUP_SIZE 16
+
+typedef struct gbFlatHashTableCtrl {
+	u8 *  bytes; // NOTE(khvorov) capacity bytes
+	isize capacity; // NOTE(khvorov) 0 or a power of 2 no less than the group size
+	isize count;
+	isize growth_left; // NOTE(khvorov) Empty slots that can be filled before a rehash
+} gbFlatHashTableCtrl;
+
+typedef struct gbFlatHashTable {
+	gbFlatHashTableCtrl ctrl;
+	u8 *        slots; // NOTE(khvorov) capacity * slot_size bytes
+	isize       key_size;
+	isize       value_offset;
+	isize       value_size;
+	isize       slot_size; // NOTE(khvorov) Includes padding after the value
+	KeyHashProc*key_hash_proc;
+	KeyCmpProc* key_cmp_proc;
+	gbAllocator allocator;
+} gbFlatHashTable;
+
+GB_DEF void gb_flat_htab_init(
+	gbFlatHashTable *htab, gbAllocator allocator, isize key_size, isize value_size,
+	KeyHashProc *key_hash_proc, KeyCmpProc *key_cmp_proc
+);
+GB_DEF void  gb_flat_htab_destroy(gbFlatHashTable *htab);
+GB_DEF void  gb_flat_htab_clear  (gbFlatHashTable *htab);
+GB_DEF void* gb_flat_htab_get    (gbFlatHashTable *htab, void *key);
+GB_DEF void  gb_flat_htab_set    (gbFlatHashTable *htab, void *key, void *value);
+GB_DEF b32   gb_flat_htab_remove (gbFlatHashTable *htab, void *key);
+GB_DEF void  gb_flat_htab_reserve(gbFlatHashTable *htab, isize count);
+
+// NOTE(khvorov) Shared with the tables GB_HTAB_DEFINE generates
+
+#if defined(GB_CPU_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define GB_FLAT_HTAB_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define GB_FLAT_HTAB_SSE2 0
+#endif
+
+#define GB_FLAT_HTAB_EMPTY   0x80
+#define GB_FLAT_HTAB_DELETED 0xFE
+
+// NOTE(khvorov) Bit i is set when control byte i of the group matches
+gb_internal u32
+gb__flat_htab_match(u8 *group, u8 ctrl) {
+#if GB_FLAT_HTAB_SSE2
+	__m128i bytes = _mm_loadu_si128((__m128i *)group);
+	u32 result = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)ctrl)));
+#else
+	u32 result = 0;
+	for (isize index = 0; index < GB_FLAT_HTAB_GROUP_SIZE; index++) {
+		result |= (u32)(group[index] == ctrl) << index;
+	}
+#endif
+	return result;
+}
+
+// NOTE(khvorov) Empty and deleted are the only control bytes with the top bit set
+gb_internal u32
+gb__flat_htab_match_free(u8 *group) {
+#if GB_FLAT_HTAB_SSE2
+	u32 result = (u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i *)group));
+#else
+	u32 result = 0;
+	for (isize index = 0; index < GB_FLAT_HTAB_GROUP_SIZE; index++) {
+		result |= (u32)(group[index] >> 7) << index;
+	}
+#endif
+	return result;
+}
+
+// NOTE(khvorov) Index of the lowest set bit, mask must not be 0
+gb_internal isize
+gb__flat_htab_first_bit(u32 mask) {
+#if defined(GB_COMPILER_MSVC)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	isize result = (isize)index;
+#else
+	isize result = (isize)__builtin_ctz(mask);
+#endif
+	return result;
+}
+
+// NOTE(khvorov) The group comes from the low bits and the control byte from
+// the top 7, so the two stay independent
+gb_internal u8
+gb__flat_htab_h2(u64 hash) {
+	u8 result = (u8)(hash >> 57);
+	return result;
+}
+
+// NOTE(khvorov) Spreads integer keys over the whole hash, groups come from
+// the low bits and control bytes from the high ones
+gb_internal u64
+gb_htab_hash_int(u64 bits) {
+	u64 result = bits * 0x9E3779B97F4A7C15ull;
+	result ^= result >> 32;
+	return result;
+}
+
+// NOTE(khvorov) Walks the slots whose control byte matches a hash, one group
+// at a time, and stops at the first group that still has an empty slot
+typedef struct gbFlatHashTableProbe {
+	u8 *  bytes;
+	isize mask;
+	isize group;
+	isize probe; // NOTE(khvorov) Groups visited so far
+	u32   matches;
+	u8    h2;
+} gbFlatHashTableProbe;
+
+gb_internal gbFlatHashTableProbe
+gb__flat_htab_probe_begin(gbFlatHashTableCtrl *ctrl, u64 hash) {
+	gbFlatHashTableProbe result = { 0 };
+	result.bytes = ctrl->bytes;
+	result.mask = ctrl->capacity - 1;
+	result.h2 = gb__flat_htab_h2(hash);
+	if (ctrl->capacity > 0) {
+		result.group = (isize)hash & result.mask & ~(isize)(GB_FLAT_HTAB_GROUP_SIZE - 1);
+		result.probe = 1;
+		result.matches = gb__flat_htab_match(result.bytes + result.group, result.h2);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Next slot that might hold the key, or -1 when none can. Groups
+// are visited once each because the group count is a power of 2.
+gb_internal isize
+gb__flat_htab_probe_next(gbFlatHashTableProbe *probe) {
+	isize result = -1;
+	while (probe->probe > 0) {
+		if (probe->matches != 0) {
+			result = probe->group + gb__flat_htab_first_bit(probe->matches);
+			probe->matches &= probe->matches - 1;
+			break;
+		}
+		b32 group_has_empty = gb__flat_htab_match(probe->bytes + probe->group, GB_FLAT_HTAB_EMPTY) != 0;
+		if (group_has_empty || probe->probe * GB_FLAT_HTAB_GROUP_SIZE > probe->mask) {
+			probe->probe = 0;
+		} else {
+			probe->group = (probe->group + probe->probe * GB_FLAT_HTAB_GROUP_SIZE) & probe->mask;
+			probe->probe += 1;
+			probe->matches = gb__flat_htab_match(probe->bytes + probe->group, probe->h2);
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) First empty or deleted slot along the hash's probe sequence
+gb_internal isize
+gb__flat_htab_find_free(gbFlatHashTableCtrl *ctrl, u64 hash) {
+	isize result = -1;
+	isize mask = ctrl->capacity - 1;
+	isize group = (isize)hash & mask & ~(isize)(GB_FLAT_HTAB_GROUP_SIZE - 1);
+	for (isize probe = 1; result < 0; probe++) {
+		GB_ASSERT(probe <= ctrl->capacity / GB_FLAT_HTAB_GROUP_SIZE);
+		u32 free_slots = gb__flat_htab_match_free(ctrl->bytes + group);
+		if (free_slots != 0) {
+			result = group + gb__flat_htab_first_bit(free_slots);
+		} else {
+			group = (group + probe * GB_FLAT_HTAB_GROUP_SIZE) & mask;
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) Free slot for a new key, counted in. The caller fills it.
+gb_internal isize
+gb__flat_htab_claim(gbFlatHashTableCtrl *ctrl, u64 hash) {
+	isize result = gb__flat_htab_find_free(ctrl, hash);
+	if (ctrl->bytes[result] == GB_FLAT_HTAB_EMPTY) {
+		ctrl->growth_left--;
+	}
+	ctrl->bytes[result] = gb__flat_htab_h2(hash);
+	ctrl->count++;
+	return result;
+}
+
+// NOTE(khvorov) A group that still has an empty slot has never been full, so
+// no probe sequence goes past it and the slot can become empty again
+gb_internal void
+gb__flat_htab_erase(gbFlatHashTableCtrl *ctrl, isize slot) {
+	u8 *group_bytes = ctrl->bytes + (slot & ~(isize)(GB_FLAT_HTAB_GROUP_SIZE - 1));
+	if (gb__flat_htab_match(group_bytes, GB_FLAT_HTAB_EMPTY) != 0) {
+		ctrl->bytes[slot] = GB_FLAT_HTAB_EMPTY;
+		ctrl->growth_left++;
+	} else {
+		ctrl->bytes[slot] = GB_FLAT_HTAB_DELETED;
+	}
+	ctrl->count--;
+}
+
+// NOTE(khvorov) Keeps the memory, costs a pass over the control bytes
+gb_internal void
+gb__flat_htab_ctrl_clear(gbFlatHashTableCtrl *ctrl) {
+	gb_memset(ctrl->bytes, GB_FLAT_HTAB_EMPTY, ctrl->capacity);
+	ctrl->count = 0;
+	ctrl->growth_left = ctrl->capacity - ctrl->capacity / 8;
+}
+
+gb_internal void
+gb__flat_htab_ctrl_free(gbFlatHashTableCtrl *ctrl, gbAllocator allocator) {
+	if (ctrl->capacity > 0) {
+		gb_free(allocator, ctrl->bytes);
+	}
+	gb_zero_item(ctrl);
+}
+
+// NOTE(khvorov) Capacity to rehash to before inserting a new key, the current
+// one while there is room. Mostly deleted slots get cleaned up in place.
+gb_internal isize
+gb__flat_htab_insert_capacity(gbFlatHashTableCtrl *ctrl) {
+	isize result = ctrl->capacity;
+	if (ctrl->growth_left == 0 && ctrl->count >= (ctrl->capacity - ctrl->capacity / 8) / 2) {
+		result = gb_max(ctrl->capacity * 2, GB_FLAT_HTAB_GROUP_SIZE);
+	}
+	return result;
+}
+
+gb_internal isize
+gb__flat_htab_reserve_capacity(gbFlatHashTableCtrl *ctrl, isize count) {
+	isize result = gb_max(ctrl->capacity, GB_FLAT_HTAB_GROUP_SIZE);
+	while (result - result / 8 < count) {
+		result *= 2;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Swaps in empty control bytes of the new capacity and returns
+// the old ones. The caller moves every full slot over with
+// gb__flat_htab_place and frees the old bytes and slots.
+gb_internal gbFlatHashTableCtrl
+gb__flat_htab_ctrl_resize(gbFlatHashTableCtrl *ctrl, isize new_capacity, gbAllocator allocator) {
+	gbFlatHashTableCtrl result = *ctrl;
+	ctrl->capacity = new_capacity;
+	ctrl->bytes = cast(u8 *)gb_alloc(allocator, new_capacity);
+	gb_memset(ctrl->bytes, GB_FLAT_HTAB_EMPTY, new_capacity);
+	ctrl->growth_left = new_capacity - new_capacity / 8 - ctrl->count;
+	return result;
+}
+
+// NOTE(khvorov) Slot for a key that is already counted, while resizing
+gb_internal isize
+gb__flat_htab_place(gbFlatHashTableCtrl *ctrl, u64 hash) {
+	isize result = gb__flat_htab_find_free(ctrl, hash);
+	ctrl->bytes[result] = gb__flat_htab_h2(hash);
+	return result;
+}
+
+// NOTE(khvorov) GB_HTAB_DEFINE(Key, Value, key_hash, key_eq) generates
+// gbHtab(Key, Value), the flat table above with the key and value types known.
+// key_hash(Key) returns a u64 and key_eq(Key, Key) a b32, both are called
+// directly so they inline into the probe loop. Integer keys can use
+// gb_htab_hash_int and gb_htab_eq. Key and Value have to be single identifiers.
+#define gbHtab(Key, Value) gbHtab_##Key##_##Value
+#define gb_htab_eq(a, b) ((a) == (b))
+
+#define GB_HTAB_DEFINE(Key, Value, key_hash, key_eq) \
+typedef struct gbHtabSlot_##Key##_##Value { \
+	Key   key; \
+	Value value; \
+} gbHtabSlot_##Key##_##Value; \
+\
+typedef struct gbHtab(Key, Value) { \
+	gbFlatHashTableCtrl         ctrl; \
+	gbHtabSlot_##Key##_##Value *slots; \
+	gbAllocator                 allocator; \
+} gbHtab(Key, Value); \
+\
+gb_internal void \
+gb_htab_init_##Key##_##Value(gbHtab(Key, Value) *htab, gbAllocator allocator) { \
+	gb_zero_item(htab); \
+	htab->allocator = allocator; \
+} \
+\
+gb_internal void \
+gb_htab_destroy_##Key##_##Value(gbHtab(Key, Value) *htab) { \
+	if (htab->ctrl.capacity > 0) { \
+		gb_free(htab->allocator, htab->slots); \
+	} \
+	gb__flat_htab_ctrl_free(&htab->ctrl, htab->allocator); \
+	htab->slots = NULL; \
+} \
+\
+gb_internal void \
+gb_htab_clear_##Key##_##Value(gbHtab(Key, Value) *htab) { \
+	gb__flat_htab_ctrl_clear(&htab->ctrl); \
+} \
+\
+gb_internal isize \
+gb__htab_find_##Key##_##Value(gbHtab(Key, Value) *htab, Key key, u64 hash) { \
+	gbFlatHashTableProbe probe = gb__flat_htab_probe_begin(&htab->ctrl, hash); \
+	isize result = gb__flat_htab_probe_next(&probe); \
+	while (result >= 0 && !key_eq(htab->slots[result].key, key)) { \
+		result = gb__flat_htab_probe_next(&probe); \
+	} \
+	return result; \
+} \
+\
+gb_internal void \
+gb__htab_resize_##Key##_##Value(gbHtab(Key, Value) *htab, isize new_capacity) { \
+	gbHtabSlot_##Key##_##Value *old_slots = htab->slots; \
+	gbFlatHashTableCtrl old_ctrl = gb__flat_htab_ctrl_resize(&htab->ctrl, new_capacity, htab->allocator); \
+	htab->slots = gb_alloc_array(htab->allocator, gbHtabSlot_##Key##_##Value, new_capacity); \
+	for (isize slot = 0; slot < old_ctrl.capacity; slot++) { \
+		if ((old_ctrl.bytes[slot] & 0x80) == 0) { \
+			htab->slots[gb__flat_htab_place(&htab->ctrl, key_hash(old_slots[slot].key))] = old_slots[slot]; \
+		} \
+	} \
+	if (old_ctrl.capacity > 0) { \
+		gb_free(htab->allocator, old_slots); \
+	} \
+	gb__flat_htab_ctrl_free(&old_ctrl, htab->allocator); \
+} \
+\
+gb_internal Value * \
+gb_htab_get_##Key##_##Value(gbHtab(Key, Value) *htab, Key key) { \
+	isize slot = gb__htab_find_##Key##_##Value(htab, key, key_hash(key)); \
+	Value *result = slot >= 0 ? &htab->slots[slot].value : NULL; \
+	return result; \
+} \
+\
+gb_internal Value * \
+gb_htab_set_##Key##_##Value(gbHtab(Key, Value) *htab, Key key, Value value) { \
+	u64 hash = key_hash(key); \
+	isize slot = gb__htab_find_##Key##_##Value(htab, key, hash); \
+	if (slot < 0) { \
+		isize new_capacity = gb__flat_htab_insert_capacity(&htab->ctrl); \
+		if (htab->ctrl.growth_left == 0) { \
+			gb__htab_resize_##Key##_##Value(htab, new_capacity); \
+		} \
+		slot = gb__flat_htab_claim(&htab->ctrl, hash); \
+		htab->slots[slot].key = key; \
+	} \
+	htab->slots[slot].value = value; \
+	Value *result = &htab->slots[slot].value; \
+	return result; \
+} \
+\
+gb_internal b32 \
+gb_htab_remove_##Key##_##Value(gbHtab(Key, Value) *htab, Key key) { \
+	isize slot = gb__htab_find_##Key##_##Value(htab, key, key_hash(key)); \
+	if (slot >= 0) { \
+		gb__flat_htab_erase(&htab->ctrl, slot); \
+	} \
+	return slot >= 0; \
+} \
+\
+gb_internal void \
+gb_htab_reserve_##Key##_##Value(gbHtab(Key, Value) *htab, isize count) { \
+	isize new_capacity = gb__flat_htab_reserve_capacity(&htab->ctrl, count); \
+	if (new_capacity != htab->ctrl.capacity) { \
+		gb__htab_resize_##Key##_##Value(htab, new_capacity); \
+	} \
+}
 
 //
 // SECTION File Handling
@@ -1912,6 +2417,10 @@ GB_DEF u64 gb_endian_swap64(u64 i);
 
 GB_DEF isize gb_count_set_bits(u64 mask);
 
+// NOTE(khvorov) Full 128-bit product, returns the low half and writes the high
+// half to hi
+GB_DEF u64 gb_mul_u64_full(u64 a, u64 b, u64 *hi);
+
 ////////////////////////////////////////////////////////////////
 //
 // Platform Stuff
@@ -4746,6 +5255,13 @@ void gb_affinity_init(gbAffinity *a) {
 		a->core_masks[0] = 1;
 	}
 
+	{
+		DWORD_PTR process_mask, system_mask;
+		a->process_mask = ~cast(usize)0;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+			a->process_mask = process_mask;
+		}
+	}
 }
 void gb_affinity_destroy(gbAffinity *a) {
 	gb_unused(a);
@@ -4768,6 +5284,10 @@ b32 gb_affinity_set(gbAffinity *a, isize core, isize thread) {
 	}
 }
 
+b32 gb_affinity_reset(gbAffinity *a) {
+	return SetThreadAffinityMask(GetCurrentThread(), a->process_mask) != 0;
+}
+
 isize gb_affinity_thread_count_for_core(gbAffinity *a, isize core) {
 	GB_ASSERT(core >= 0 && core < a->core_count);
 	return gb_count_set_bits(a->core_masks[core]);
@@ -4822,6 +5342,16 @@ b32 gb_affinity_set(gbAffinity *a, isize core, isize thread_index) {
 	return result == KERN_SUCCESS;
 }
 
+b32 gb_affinity_reset(gbAffinity *a) {
+	thread_affinity_policy_data_t info;
+	kern_return_t result;
+	gb_unused(a);
+
+	info.affinity_tag = THREAD_AFFINITY_TAG_NULL;
+	result = thread_policy_set(mach_thread_self(), THREAD_AFFINITY_POLICY, cast(thread_policy_t)&info, THREAD_AFFINITY_POLICY_COUNT);
+	return result == KERN_SUCCESS;
+}
+
 isize gb_affinity_thread_count_for_core(gbAffinity *a, isize core) {
 	GB_ASSERT(core >= 0 && core < a->core_count);
 	return a->threads_per_core;
@@ -4846,6 +5376,20 @@ void gb_affinity_init(gbAffinity *a) {
 		accurate = false;
 	}
 
+	// NOTE(khvorov) Only the processors the thread may run on count, a cpuset
+	// or taskset can leave out any of the online ones
+	if (sched_getaffinity(0, gb_size_of(a->allowed), &a->allowed) == 0 && CPU_COUNT(&a->allowed) > 0) {
+		a->core_count = CPU_COUNT(&a->allowed);
+	} else {
+		isize cpu;
+		CPU_ZERO(&a->allowed);
+		for (cpu = 0; cpu < a->core_count && cpu < CPU_SETSIZE; cpu++) {
+			CPU_SET(cpu, &a->allowed);
+		}
+		a->core_count = CPU_COUNT(&a->allowed);
+		accurate = false;
+	}
+
 	// Parsing /proc/cpuinfo to get the number of threads per core.
 	// NOTE(zangent): This calls the CPU's threads "cores", although the wording
 	// is kind of weird. This should be right, though.
@@ -4903,7 +5447,28 @@ void gb_affinity_destroy(gbAffinity *a) {
 }
 
 b32 gb_affinity_set(gbAffinity *a, isize core, isize thread_index) {
-	return true;
+	// NOTE(khvorov) core_count is the number of allowed logical processors
+	// here, so a core is the core-th processor in the mask and thread_index
+	// has to be 0
+	cpu_set_t cpu_set;
+	isize cpu = -1;
+	GB_ASSERT(0 <= core && core < a->core_count);
+	GB_ASSERT(thread_index == 0);
+
+	while (core >= 0) {
+		cpu++;
+		if (CPU_ISSET(cpu, &a->allowed)) {
+			core--;
+		}
+	}
+
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	return pthread_setaffinity_np(pthread_self(), gb_size_of(cpu_set), &cpu_set) == 0;
+}
+
+b32 gb_affinity_reset(gbAffinity *a) {
+	return pthread_setaffinity_np(pthread_self(), gb_size_of(a->allowed), &a->allowed) == 0;
 }
 
 isize gb_affinity_thread_count_for_core(gbAffinity *a, isize core) {
@@ -5062,6 +5627,8 @@ gb_inline void gb_arena_init_from_memory(gbArena *arena, void *start, isize size
 	arena->total_size      = size;
 	arena->total_allocated = 0;
 	arena->temp_count      = 0;
+	arena->block_size      = 0;
+	arena->block_count     = 0;
 }
 
 gb_inline void gb_arena_init_from_allocator(gbArena *arena, gbAllocator backing, isize size) {
@@ -5070,12 +5637,47 @@ gb_inline void gb_arena_init_from_allocator(gbArena *arena, gbAllocator backing,
 	arena->total_size      = size;
 	arena->total_allocated = 0;
 	arena->temp_count      = 0;
+	arena->block_size      = size;
+	arena->block_count     = 0;
+}
+
+gb_internal b32 gb__arena_push_block(gbArena *arena, isize min_size) {
+	gbArenaBlockHeader *header;
+	isize size = gb_max(arena->block_size, min_size + gb_size_of(gbArenaBlockHeader));
+	void *block;
+	if (arena->backing.proc == NULL || arena->block_size == 0)
+		return false;
+	block = gb_alloc(arena->backing, size);
+	if (block == NULL)
+		return false;
+	header = cast(gbArenaBlockHeader *)block;
+	header->prev_start     = arena->physical_start;
+	header->prev_size      = arena->total_size;
+	header->prev_allocated = arena->total_allocated;
+	arena->physical_start  = block;
+	arena->total_size      = size;
+	arena->total_allocated = gb_size_of(gbArenaBlockHeader);
+	arena->block_count++;
+	return true;
+}
+
+gb_internal void gb__arena_pop_block(gbArena *arena) {
+	gbArenaBlockHeader header;
+	GB_ASSERT(arena->block_count > 0);
+	header = *cast(gbArenaBlockHeader *)arena->physical_start;
+	gb_free(arena->backing, arena->physical_start);
+	arena->physical_start  = header.prev_start;
+	arena->total_size      = header.prev_size;
+	arena->total_allocated = header.prev_allocated;
+	arena->block_count--;
 }
 
 gb_inline void gb_arena_init_sub(gbArena *arena, gbArena *parent_arena, isize size) { gb_arena_init_from_allocator(arena, gb_arena_allocator(parent_arena), size); }
 
 
 gb_inline void gb_arena_free(gbArena *arena) {
+	while (arena->block_count > 0)
+		gb__arena_pop_block(arena);
 	if (arena->backing.proc) {
 		gb_free(arena->backing, arena->physical_start);
 		arena->physical_start = NULL;
@@ -5128,8 +5730,11 @@ GB_ALLOCATOR_PROC(gb_arena_allocator_proc) {
 
 		// NOTE(bill): Out of memory
 		if (arena->total_allocated + total_size > cast(isize)arena->total_size) {
-			gb_printf_err("Arena out of memory\n");
-			return NULL;
+			if (!gb__arena_push_block(arena, total_size)) {
+				gb_printf_err("Arena out of memory\n");
+				return NULL;
+			}
+			end = gb_pointer_add(arena->physical_start, arena->total_allocated);
 		}
 
 		ptr = gb_align_forward(end, alignment);
@@ -5144,6 +5749,8 @@ GB_ALLOCATOR_PROC(gb_arena_allocator_proc) {
 		break;
 
 	case gbAllocation_FreeAll:
+		while (arena->block_count > 0)
+			gb__arena_pop_block(arena);
 		arena->total_allocated = 0;
 		break;
 
@@ -5160,12 +5767,16 @@ GB_ALLOCATOR_PROC(gb_arena_allocator_proc) {
 gb_inline gbTempArenaMemory gb_temp_arena_memory_begin(gbArena *arena) {
 	gbTempArenaMemory tmp;
 	tmp.arena = arena;
+	tmp.original_start = arena->physical_start;
 	tmp.original_count = arena->total_allocated;
 	arena->temp_count++;
 	return tmp;
 }
 
 gb_inline void gb_temp_arena_memory_end(gbTempArenaMemory tmp) {
+	// NOTE(khvorov) Blocks chained on since the checkpoint go back to the backing allocator
+	while (tmp.arena->physical_start != tmp.original_start)
+		gb__arena_pop_block(tmp.arena);
 	GB_ASSERT_MSG(tmp.arena->total_allocated >= tmp.original_count,
 	              "%td >= %td", tmp.arena->total_allocated, tmp.original_count);
 	GB_ASSERT(tmp.arena->temp_count > 0);
@@ -5726,7 +6337,8 @@ void gb_shuffle(void *base, isize count, isize size) {
 
 	a = cast(u8 *)base + (count-1) * size;
 	for (i = count; i > 1; i--) {
-		j = gb_random_gen_isize(&random) % i;
+		// NOTE(khvorov) The random isize can be negative
+		j = cast(isize)(cast(usize)gb_random_gen_isize(&random) % cast(usize)i);
 		gb_memswap(a, cast(u8 *)base + j*size, size);
 		a -= size;
 	}
@@ -7174,8 +7786,8 @@ u64 gb_murmur64_seed(void const *data_, isize len, u64 seed) {
 	u64 h = seed ^ (len * m);
 
 	u64 const *data = cast(u64 const *)data_;
-	u8  const *data2 = cast(u8 const *)data_;
 	u64 const* end = data + (len / 8);
+	u8  const *data2 = cast(u8 const *)end;
 
 	while (data != end) {
 		u64 k = *data++;
@@ -7266,6 +7878,105 @@ u64 gb_murmur64_seed(void const *data_, isize len, u64 seed) {
 #endif
 }
 
+gb_global u64 const gb__wyhash_secret[4] = {
+	0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+// NOTE(khvorov) Low half of the 128-bit product in a, high half in b
+gb_internal void
+gb__wyhash_mum(u64 *a, u64 *b) {
+	*a = gb_mul_u64_full(*a, *b, b);
+}
+
+gb_internal u64
+gb__wyhash_mix(u64 a, u64 b) {
+	gb__wyhash_mum(&a, &b);
+	u64 result = a ^ b;
+	return result;
+}
+
+// NOTE(khvorov) Unaligned loads, gb_memcopy is rep movsb which is far too
+// slow for a few bytes
+gb_internal u64
+gb__wyhash_read8(u8 const *data) {
+#if defined(GB_COMPILER_GCC) || defined(GB_COMPILER_CLANG)
+	u64 result;
+	__builtin_memcpy(&result, data, 8);
+#else
+	u64 result = *cast(u64 const *)data;
+#endif
+	return result;
+}
+
+gb_internal u64
+gb__wyhash_read4(u8 const *data) {
+#if defined(GB_COMPILER_GCC) || defined(GB_COMPILER_CLANG)
+	u32 result;
+	__builtin_memcpy(&result, data, 4);
+#else
+	u32 result = *cast(u32 const *)data;
+#endif
+	return result;
+}
+
+// NOTE(khvorov) The seed has already been mixed with the secret
+gb_internal gb_inline u64
+gb__wyhash(u8 const *data, isize len, u64 seed) {
+	u64 const *secret = gb__wyhash_secret;
+	u64 a, b;
+
+	if (len <= 16) {
+		if (len >= 4) {
+			// NOTE(khvorov) Two overlapping pairs of 4-byte reads cover 4 to 16 bytes
+			isize step = (len >> 3) << 2;
+			a = (gb__wyhash_read4(data) << 32) | gb__wyhash_read4(data + step);
+			b = (gb__wyhash_read4(data + len - 4) << 32) | gb__wyhash_read4(data + len - 4 - step);
+		} else if (len > 0) {
+			a = (cast(u64)data[0] << 16) | (cast(u64)data[len >> 1] << 8) | data[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		isize left = len;
+		if (left > 48) {
+			u64 seed1 = seed, seed2 = seed;
+			do {
+				seed  = gb__wyhash_mix(gb__wyhash_read8(data)      ^ secret[1], gb__wyhash_read8(data + 8)  ^ seed);
+				seed1 = gb__wyhash_mix(gb__wyhash_read8(data + 16) ^ secret[2], gb__wyhash_read8(data + 24) ^ seed1);
+				seed2 = gb__wyhash_mix(gb__wyhash_read8(data + 32) ^ secret[3], gb__wyhash_read8(data + 40) ^ seed2);
+				data += 48;
+				left -= 48;
+			} while (left > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (left > 16) {
+			seed = gb__wyhash_mix(gb__wyhash_read8(data) ^ secret[1], gb__wyhash_read8(data + 8) ^ seed);
+			data += 16;
+			left -= 16;
+		}
+		a = gb__wyhash_read8(data + left - 16);
+		b = gb__wyhash_read8(data + left - 8);
+	}
+
+	a ^= secret[1];
+	b ^= seed;
+	gb__wyhash_mum(&a, &b);
+	return gb__wyhash_mix(a ^ secret[0] ^ cast(u64)len, b ^ secret[1]);
+}
+
+// NOTE(khvorov) A seed of 0 after mixing
+#define GB__WYHASH_SEED_0 0xca813bf4c7abf0a9ull
+
+u64 gb_wyhash64(void const *data, isize len) {
+	return gb__wyhash(cast(u8 const *)data, len, GB__WYHASH_SEED_0);
+}
+
+u64 gb_wyhash64_seed(void const *data, isize len, u64 seed) {
+	seed ^= gb__wyhash_mix(seed ^ gb__wyhash_secret[0], gb__wyhash_secret[1]);
+	return gb__wyhash(cast(u8 const *)data, len, seed);
+}
+
 //
 // SECTION Hash Table
 //
@@ -7283,12 +7994,19 @@ gb_htab_init(
 
 	htab->key_hash_proc = key_hash_proc;
 	htab->key_cmp_proc = key_cmp_proc;
+	htab->incremental_rehash = false;
+	gb_zero_item(&htab->old_entry_indices);
+	htab->old_entry_indices_moved = 0;
 
 	gb_htab__reset_entry_indices(htab);
 }
 
 void
 gb_htab_clear(gbHashTable *htab) {
+	if (htab->old_entry_indices.len > 0) {
+		gb_array_free(&htab->old_entry_indices);
+		gb_zero_item(&htab->old_entry_indices);
+	}
 	gb_htab__reset_entry_indices(htab);
 	gb_array_clear(&htab->entry_headers);
 	gb_array_clear(&htab->key_values);
@@ -7297,6 +8015,9 @@ gb_htab_clear(gbHashTable *htab) {
 
 void
 gb_htab_destroy(gbHashTable *htab) {
+	if (htab->old_entry_indices.len > 0) {
+		gb_array_free(&htab->old_entry_indices);
+	}
 	gb_array_free(&htab->entry_indices);
 	gb_array_free(&htab->entry_headers);
 	gb_array_free(&htab->key_values);
@@ -7319,6 +8040,9 @@ gb_htab_set(gbHashTable *htab, void *key, void *value) {
 	if (htab->entry_indices.len == 0) {
 		gb_htab_grow(htab);
 	}
+	if (htab->old_entry_indices.len > 0) {
+		gb_htab__move_buckets(htab, GB_HTAB_REHASH_BUCKETS_PER_SET);
+	}
 
 	gbHashTableFindResult fr = gb_htab__find(htab, key);
 
@@ -7331,7 +8055,7 @@ gb_htab_set(gbHashTable *htab, void *key, void *value) {
 			gbHashTableEntryHeader *prev = gb_array_get(&htab->entry_headers, fr.entry_prev);
 			prev->next = index;
 		} else {
-			gb_array_set(&htab->entry_indices, fr.entry_index_index, &index);
+			gb_array_set(fr.entry_indices, fr.entry_index_index, &index);
 		}
 	}
 
@@ -7342,15 +8066,32 @@ gb_htab_set(gbHashTable *htab, void *key, void *value) {
 	}
 }
 
+// NOTE(khvorov) An incremental rehash still in progress is finished first.
+// With the chains added to the front of the new buckets, a set moves enough
+// buckets for the rehash to be done before the table is full again.
 void
 gb_htab_grow(gbHashTable *htab) {
 	isize new_count = gb_array_grow_formula(htab->entry_headers.len);
-	gb_htab_rehash(htab, new_count);
+	if (htab->incremental_rehash && htab->entry_indices.len > 0) {
+		gb_htab__move_buckets(htab, htab->old_entry_indices.len);
+		htab->old_entry_indices = htab->entry_indices;
+		htab->old_entry_indices_moved = 0;
+		gb_array_init_reserve(&htab->entry_indices, htab->old_entry_indices.allocator, gb_size_of(isize), new_count);
+		htab->entry_indices.len = new_count;
+		// NOTE(khvorov) All bytes 0xFF is -1
+		gb_memset(htab->entry_indices.ptr, 0xFF, new_count * gb_size_of(isize));
+	} else {
+		gb_htab_rehash(htab, new_count);
+	}
 }
 
 void
 gb_htab_rehash(gbHashTable *htab, isize new_count) {
 
+	if (htab->old_entry_indices.len > 0) {
+		gb_htab__move_buckets(htab, htab->old_entry_indices.len);
+	}
+
 	gbHashTable new_htab = { 0 };
 	gb_htab_init(
 		&new_htab, htab->entry_indices.allocator,
@@ -7400,6 +8141,7 @@ gb_htab_rehash(gbHashTable *htab, isize new_count) {
 	gb_htab_destroy(htab);
 	htab->entry_indices  = new_htab.entry_indices;
 	htab->entry_headers = new_htab.entry_headers;
+	htab->key_values = new_htab.key_values;
 	htab->entry_values = new_htab.entry_values;
 }
 
@@ -7426,13 +8168,19 @@ gb_htab__add_header(gbHashTable *htab) {
 gbHashTableFindResult
 gb_htab__find(gbHashTable *htab, void *key) {
 
-	gbHashTableFindResult result = { -1, -1, -1 };
+	gbHashTableFindResult result = { &htab->entry_indices, -1, -1, -1 };
 
 	if (htab->entry_indices.len > 0) {
 
 		u64 key_hash = htab->key_hash_proc(key);
-		result.entry_index_index = key_hash % htab->entry_indices.len;
-		result.entry_index = *(isize *)gb_array_get(&htab->entry_indices, result.entry_index_index);
+		if (htab->old_entry_indices.len > 0) {
+			isize old_entry_index_index = key_hash % htab->old_entry_indices.len;
+			if (old_entry_index_index >= htab->old_entry_indices_moved) {
+				result.entry_indices = &htab->old_entry_indices;
+			}
+		}
+		result.entry_index_index = key_hash % result.entry_indices->len;
+		result.entry_index = *(isize *)gb_array_get(result.entry_indices, result.entry_index_index);
 
 		while (result.entry_index >= 0) {
 			gbHashTableEntryHeader *this_header = gb_array_get(&htab->entry_headers, result.entry_index);
@@ -7454,6 +8202,179 @@ gb_htab__full(gbHashTable *htab) {
 	return result;
 }
 
+void
+gb_htab__move_buckets(gbHashTable *htab, isize bucket_count) {
+	isize *old_entry_indices = htab->old_entry_indices.ptr;
+	isize *entry_indices = htab->entry_indices.ptr;
+	gbHashTableEntryHeader *entry_headers = htab->entry_headers.ptr;
+
+	isize moved_end = gb_min(htab->old_entry_indices_moved + bucket_count, htab->old_entry_indices.len);
+	for (isize bucket = htab->old_entry_indices_moved; bucket < moved_end; bucket++) {
+		isize entry_index = old_entry_indices[bucket];
+		while (entry_index >= 0) {
+			isize next = entry_headers[entry_index].next;
+			void *key = gb_array_get(&htab->key_values, entry_index);
+			isize new_bucket = htab->key_hash_proc(key) % htab->entry_indices.len;
+			entry_headers[entry_index].next = entry_indices[new_bucket];
+			entry_indices[new_bucket] = entry_index;
+			entry_index = next;
+		}
+	}
+	htab->old_entry_indices_moved = moved_end;
+
+	if (htab->old_entry_indices_moved == htab->old_entry_indices.len) {
+		gb_array_free(&htab->old_entry_indices);
+		gb_zero_item(&htab->old_entry_indices);
+		htab->old_entry_indices_moved = 0;
+	}
+}
+
+//
+// SECTION Flat Hash Table
+//
+
+gb_internal isize
+gb__flat_htab_align(isize size) {
+	isize result = size >= 8 ? 8 : size >= 4 ? 4 : size >= 2 ? 2 : 1;
+	return result;
+}
+
+gb_internal gb_inline b32
+gb__flat_htab_key_eq(gbFlatHashTable *htab, void *slot_key, void *key) {
+	b32 result;
+	if (htab->key_cmp_proc != NULL) {
+		result = htab->key_cmp_proc(slot_key, key);
+	} else if (htab->key_size == 4) {
+		result = *(u32 *)slot_key == *(u32 *)key;
+	} else if (htab->key_size == 8) {
+		result = *(u64 *)slot_key == *(u64 *)key;
+	} else {
+		result = gb_memcompare(slot_key, key, htab->key_size) == 0;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Without a hash proc, 4 and 8 byte keys are mixed inline and
+// anything else goes through murmur
+gb_internal gb_inline u64
+gb__flat_htab_hash(gbFlatHashTable *htab, void *key) {
+	u64 result;
+	if (htab->key_hash_proc != NULL) {
+		result = htab->key_hash_proc(key);
+	} else if (htab->key_size == 4 || htab->key_size == 8) {
+		result = gb_htab_hash_int(htab->key_size == 4 ? *(u32 *)key : *(u64 *)key);
+	} else {
+		result = gb_murmur64(key, htab->key_size);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Returns the slot of the key or -1
+gb_internal gb_inline isize
+gb__flat_htab_find(gbFlatHashTable *htab, void *key, u64 hash) {
+	gbFlatHashTableProbe probe = gb__flat_htab_probe_begin(&htab->ctrl, hash);
+	isize result = gb__flat_htab_probe_next(&probe);
+	while (result >= 0 && !gb__flat_htab_key_eq(htab, htab->slots + result * htab->slot_size, key)) {
+		result = gb__flat_htab_probe_next(&probe);
+	}
+	return result;
+}
+
+gb_internal void
+gb__flat_htab_resize(gbFlatHashTable *htab, isize new_capacity) {
+	u8 *old_slots = htab->slots;
+	gbFlatHashTableCtrl old_ctrl = gb__flat_htab_ctrl_resize(&htab->ctrl, new_capacity, htab->allocator);
+	htab->slots = cast(u8 *)gb_alloc(htab->allocator, new_capacity * htab->slot_size);
+
+	for (isize slot = 0; slot < old_ctrl.capacity; slot++) {
+		if ((old_ctrl.bytes[slot] & 0x80) == 0) {
+			u8 *old_slot = old_slots + slot * htab->slot_size;
+			isize new_slot = gb__flat_htab_place(&htab->ctrl, gb__flat_htab_hash(htab, old_slot));
+			gb_memcopy(htab->slots + new_slot * htab->slot_size, old_slot, htab->slot_size);
+		}
+	}
+
+	if (old_ctrl.capacity > 0) {
+		gb_free(htab->allocator, old_slots);
+	}
+	gb__flat_htab_ctrl_free(&old_ctrl, htab->allocator);
+}
+
+void
+gb_flat_htab_init(
+	gbFlatHashTable *htab, gbAllocator allocator, isize key_size, isize value_size,
+	KeyHashProc *key_hash_proc, KeyCmpProc *key_cmp_proc
+) {
+	gb_zero_item(htab);
+	isize align = gb_max(gb__flat_htab_align(key_size), gb__flat_htab_align(value_size));
+	htab->allocator = allocator;
+	htab->key_size = key_size;
+	htab->value_offset = (key_size + align - 1) & ~(align - 1);
+	htab->value_size = value_size;
+	htab->slot_size = (htab->value_offset + value_size + align - 1) & ~(align - 1);
+	htab->key_hash_proc = key_hash_proc;
+	htab->key_cmp_proc = key_cmp_proc;
+}
+
+void
+gb_flat_htab_destroy(gbFlatHashTable *htab) {
+	if (htab->ctrl.capacity > 0) {
+		gb_free(htab->allocator, htab->slots);
+	}
+	gb__flat_htab_ctrl_free(&htab->ctrl, htab->allocator);
+	htab->slots = NULL;
+}
+
+void
+gb_flat_htab_clear(gbFlatHashTable *htab) {
+	gb__flat_htab_ctrl_clear(&htab->ctrl);
+}
+
+void *
+gb_flat_htab_get(gbFlatHashTable *htab, void *key) {
+	isize slot = gb__flat_htab_find(htab, key, gb__flat_htab_hash(htab, key));
+	void *result = NULL;
+	if (slot >= 0) {
+		result = htab->slots + slot * htab->slot_size + htab->value_offset;
+	}
+	return result;
+}
+
+void
+gb_flat_htab_set(gbFlatHashTable *htab, void *key, void *value) {
+	u64 hash = gb__flat_htab_hash(htab, key);
+	isize slot = gb__flat_htab_find(htab, key, hash);
+
+	if (slot < 0) {
+		isize new_capacity = gb__flat_htab_insert_capacity(&htab->ctrl);
+		if (htab->ctrl.growth_left == 0) {
+			gb__flat_htab_resize(htab, new_capacity);
+		}
+		slot = gb__flat_htab_claim(&htab->ctrl, hash);
+		gb_memcopy(htab->slots + slot * htab->slot_size, key, htab->key_size);
+	}
+
+	gb_memcopy(htab->slots + slot * htab->slot_size + htab->value_offset, value, htab->value_size);
+}
+
+b32
+gb_flat_htab_remove(gbFlatHashTable *htab, void *key) {
+	isize slot = gb__flat_htab_find(htab, key, gb__flat_htab_hash(htab, key));
+	b32 result = slot >= 0;
+	if (result) {
+		gb__flat_htab_erase(&htab->ctrl, slot);
+	}
+	return result;
+}
+
+void
+gb_flat_htab_reserve(gbFlatHashTable *htab, isize count) {
+	isize new_capacity = gb__flat_htab_reserve_capacity(&htab->ctrl, count);
+	if (new_capacity != htab->ctrl.capacity) {
+		gb__flat_htab_resize(htab, new_capacity);
+	}
+}
+
 //
 // SECTION File Handling
 //
@@ -9037,6 +9958,25 @@ gb_inline isize gb_count_set_bits(u64 mask) {
 	return count;
 }
 
+gb_inline u64 gb_mul_u64_full(u64 a, u64 b, u64 *hi) {
+	u64 result;
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 product = (unsigned __int128)a * b;
+	*hi = (u64)(product >> 64);
+	result = (u64)product;
+#elif defined(GB_COMPILER_MSVC) && defined(GB_ARCH_64_BIT)
+	result = _umul128(a, b, hi);
+#else
+	u64 a_hi = a >> 32, a_lo = (u32)a;
+	u64 b_hi = b >> 32, b_lo = (u32)b;
+	u64 hi_hi = a_hi * b_hi, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, lo_lo = a_lo * b_lo;
+	u64 middle = (lo_lo >> 32) + (u32)hi_lo + lo_hi;
+	*hi = hi_hi + (hi_lo >> 32) + (middle >> 32);
+	result = (middle << 32) | (u32)lo_lo;
+#endif
+	return result;
+}
+
 
 
 
@@ -2,8 +2,20 @@
 #define GB_STATIC
 #include "gb.h"
 
+#include <stdio.h>
+
 #include "llvm-c/Core.h"
 #include "llvm-c/Analysis.h"
+#include "llvm-c/ExecutionEngine.h"
+#include "llvm-c/Target.h"
+#include "llvm-c/BitReader.h"
+#include "llvm-c/BitWriter.h"
+#include "llvm-c/Linker.h"
+#include "llvm-c/Support.h"
+#include "llvm-c/Transforms/InstCombine.h"
+#include "llvm-c/Transforms/PassManagerBuilder.h"
+#include "llvm-c/Transforms/Scalar.h"
+#include "llvm-c/Transforms/Utils.h"
 
 
 #if defined(GB_COMPILER_MSVC)
@@ -21,12 +33,37 @@ typedef struct String {
 	isize len; // NOTE(khvorov) Does not include the null terminator
 } String;
 
+// NOTE(khvorov) Index of an interned identifier, 0 is no identifier
+typedef u32 Symbol;
+
+GB_ARRAY_DEFINE(u8)
+GB_ARRAY_DEFINE(u32)
+GB_ARRAY_DEFINE(f64)
+GB_ARRAY_DEFINE(isize)
+GB_ARRAY_DEFINE(Symbol)
+
+typedef struct SymbolTable {
+	gbHashTable ids;
+	gbDynamicArray names;
+	gbAllocator allocator;
+	char *block;
+	isize block_remaining;
+} SymbolTable;
+
 
 typedef enum TokenKind {
 	TokenType_EOF,
 
 	TokenType_Def,
 	TokenType_Extern,
+	TokenType_Binary,
+	TokenType_Unary,
+	TokenType_If,
+	TokenType_Then,
+	TokenType_Else,
+	TokenType_For,
+	TokenType_In,
+	TokenType_Var,
 
 	TokenType_Identifier,
 	TokenType_Number,
@@ -36,87 +73,455 @@ typedef enum TokenKind {
 
 typedef struct Token {
 	TokenKind type;
-	String identifier;
+	Symbol symbol;
+	String identifier; // NOTE(khvorov) Source text of the token
 	f64 number;
 	char ascii;
 } Token;
 
+GB_ARRAY_DEFINE(Token)
+
+// NOTE(khvorov) Compact form of a token array for when all tokens are kept.
+// Numbers and symbols are only stored for the tokens that have them and are
+// read back in order. Ascii tokens are read straight from the source.
+typedef struct TokenStream {
+	String source;
+	gbArray(u8) kinds;
+	gbArray(u32) offsets; // NOTE(khvorov) From the start of source
+	gbArray(Symbol) symbols;
+	gbArray(f64) numbers;
+} TokenStream;
+
+// NOTE(khvorov) Piece of the source lexed on its own. Symbols are local to the
+// chunk until the chunks are joined.
+typedef struct LexChunk {
+	String input;
+	TokenStream stream;
+	gbArena arena;
+	SymbolTable symbols;
+} LexChunk;
+
+
+typedef enum AstType {
+	AstType_None,
+	AstType_Number,
+	AstType_Variable,
+	AstType_Unary,
+	AstType_Binary,
+	AstType_Call,
+	AstType_If,
+	AstType_For,
+	AstType_Var,
+} AstType;
+
+#define AST_TYPE_BITS 4
+
+// NOTE(khvorov) AstType in the low bits and the index into the pool of that
+// type above them. 0 is no expression.
+typedef u32 AstExpr;
 
 typedef struct AstNumber {
 	f64 val;
 } AstNumber;
 
 typedef struct AstVariable {
-	String name;
+	Symbol name;
 } AstVariable;
 
 typedef struct AstParameter {
-	String name;
+	Symbol name;
 } AstParameter;
 
-typedef struct AstArgument {
-	struct AstNode *val;
-	struct AstArgument *next;
-} AstArgument;
+typedef struct AstUnary {
+	char op;
+	Symbol function; // NOTE(khvorov) The unary operator's definition
+	AstExpr operand;
+} AstUnary;
 
 typedef struct AstBinary {
 	char op;
-	struct AstNode *lhs;
-	struct AstNode *rhs;
+	Symbol function; // NOTE(khvorov) 0 for the built-in operators
+	AstExpr lhs;
+	AstExpr rhs;
 } AstBinary;
 
+// NOTE(khvorov) Arguments are args[arg_start..arg_start + arg_count) in the pool
 typedef struct AstCall {
-	String callee;
-	AstArgument *args;
-	isize arg_count;
+	Symbol callee;
+	u32 arg_start;
+	u32 arg_count;
 } AstCall;
 
+typedef enum AstPrototypeKind {
+	AstPrototypeKind_Function,
+	AstPrototypeKind_Unary,
+	AstPrototypeKind_Binary,
+} AstPrototypeKind;
+
+typedef struct AstIf {
+	AstExpr cond;
+	AstExpr then_branch;
+	AstExpr else_branch;
+} AstIf;
+
+// NOTE(khvorov) for var = start, end, step in body. No step means 1.
+typedef struct AstFor {
+	Symbol var;
+	AstExpr start;
+	AstExpr end;
+	AstExpr step;
+	AstExpr body;
+} AstFor;
+
+typedef struct AstVarBinding {
+	Symbol name;
+	AstExpr init; // NOTE(khvorov) 0 means 0.0
+} AstVarBinding;
+
+// NOTE(khvorov) var a = init, b in body. Bindings are
+// var_bindings[binding_start..binding_start + binding_count) in the pool.
+typedef struct AstVar {
+	u32 binding_start;
+	u32 binding_count;
+	AstExpr body;
+} AstVar;
+
 typedef struct AstPrototype {
-	String name;
+	Symbol name;
+	AstPrototypeKind kind;
+	u8 precedence; // NOTE(khvorov) Binary operators only
 	AstParameter *param;
 	isize param_count;
+	b32 has_body; // NOTE(khvorov) Comes from a definition rather than an extern
 } AstPrototype;
 
 typedef struct AstFunction {
 	AstPrototype *proto;
-	struct AstNode *body;
+	AstExpr body;
 } AstFunction;
 
-typedef enum AstType {
-	AstType_None,
-	AstType_Number,
-	AstType_Variable,
-	AstType_Binary,
-	AstType_Call,
-} AstType;
-
-typedef struct AstNode {
-	AstType type;
-	union {
-		AstNumber number;
-		AstVariable variable;
-		AstBinary binary;
-		AstCall call;
-	};
-} AstNode;
+// NOTE(khvorov) Expression nodes of each type are stored contiguously. Children
+// are always added before their parents.
+typedef struct AstPool {
+	gbDynamicArray numbers; // NOTE(khvorov) AstNumber
+	gbDynamicArray variables; // NOTE(khvorov) AstVariable
+	gbDynamicArray unaries; // NOTE(khvorov) AstUnary
+	gbDynamicArray binaries; // NOTE(khvorov) AstBinary
+	gbDynamicArray calls; // NOTE(khvorov) AstCall
+	gbDynamicArray args; // NOTE(khvorov) AstExpr
+	gbDynamicArray ifs; // NOTE(khvorov) AstIf
+	gbDynamicArray fors; // NOTE(khvorov) AstFor
+	gbDynamicArray vars; // NOTE(khvorov) AstVar
+	gbDynamicArray var_bindings; // NOTE(khvorov) AstVarBinding
+} AstPool;
+
+typedef struct AstPoolMark {
+	isize numbers;
+	isize variables;
+	isize unaries;
+	isize binaries;
+	isize calls;
+	isize args;
+	isize ifs;
+	isize fors;
+	isize vars;
+	isize var_bindings;
+} AstPoolMark;
+
+typedef struct SourceReader {
+	gbFile *file;
+	gbAllocator allocator;
+	char *buffer;
+	isize buffer_cap;
+	isize buffer_len;
+	isize lines_len; // NOTE(khvorov) Complete lines at the start of the buffer
+	b32 eof;
+} SourceReader;
+
+typedef struct SourceMapping {
+	void *data;
+	isize size;
+#if defined(GB_SYSTEM_WINDOWS)
+	HANDLE win32_mapping;
+#endif
+} SourceMapping;
+
+typedef struct Lexer {
+	SourceReader reader; // NOTE(khvorov) Unused when lexing a mapped file
+	String input;
+} Lexer;
+
+// NOTE(khvorov) Must be a power of 2
+#define PARSER_TOKEN_RING_SIZE 16
+
+typedef enum ParseFrameType {
+	ParseFrame_Unary,
+	ParseFrame_Binary,
+	ParseFrame_Paren,
+	ParseFrame_Call,
+	ParseFrame_If,
+	ParseFrame_For,
+	ParseFrame_Var,
+} ParseFrameType;
+
+// NOTE(khvorov) Which part of an if, a for or a var is being parsed
+typedef enum ParseStage {
+	ParseStage_Cond,
+	ParseStage_Then,
+	ParseStage_Else,
+	ParseStage_Start,
+	ParseStage_End,
+	ParseStage_Step,
+	ParseStage_Body,
+	ParseStage_VarInit,
+	ParseStage_VarBody,
+} ParseStage;
+
+// NOTE(khvorov) Something the expression parser has opened but not finished
+typedef struct ParseFrame {
+	ParseFrameType type;
+	char op;
+	u8 stage; // NOTE(khvorov) ParseStage
+	b8 has_step;
+	i32 precedence;
+	Symbol name; // NOTE(khvorov) Callee or loop variable
+	u32 operand_start; // NOTE(khvorov) Start of the bindings for a var
+} ParseFrame;
 
 typedef struct AstParser {
 	gbArena arena;
 	gbAllocator arena_allocator;
-	Token *token;
-	isize token_count;
+	Lexer *lexer; // NOTE(khvorov) Either lexer or stream is set
+	TokenStream *stream;
+	isize stream_token_index;
+	isize stream_symbol_index;
+	isize stream_number_index;
+	Token *token; // NOTE(khvorov) Current token, EOF once the input runs out
+	Token token_ring[PARSER_TOKEN_RING_SIZE];
+	isize ring_head;
+	isize ring_count;
+	AstPool ast;
+	gbDynamicArray frames; // NOTE(khvorov) ParseFrame
+	gbDynamicArray operands; // NOTE(khvorov) AstExpr
+	gbDynamicArray bindings; // NOTE(khvorov) AstVarBinding of unfinished vars
+	u8 binary_precedence[256]; // NOTE(khvorov) 0 means not a binary operator
+	// NOTE(khvorov) Filled in as operators get used. Interning while parsing
+	// leaves codegen, which can run on several threads, only reading symbols.
+	Symbol unary_functions[256];
+	Symbol binary_functions[256];
 } AstParser;
 
 
+typedef enum JitSection {
+	JitSection_Code,
+	JitSection_ReadOnly,
+	JitSection_Data,
+	JitSection_Count,
+} JitSection;
+
+// NOTE(khvorov) Pages below protected_end have their final protection, pages
+// from there to writable_end are read-write, anything further is untouched.
+// protected_end can be past used, the page used ends in is written again
+// after it is made writable.
+typedef struct JitArena {
+	u8 *base;
+	isize size;
+	isize used;
+	isize protected_end;
+	isize writable_end;
+} JitArena;
+
+// NOTE(khvorov) Address space is reserved up front and split between the
+// sections. Pages are committed as the used part of a section grows into them.
+typedef struct JitMemory {
+	u8 *base;
+	isize reserved;
+	isize page_size;
+	JitArena arenas[JitSection_Count];
+} JitMemory;
+
+typedef enum JitProtect {
+	JitProtect_ReadWrite,
+	JitProtect_ReadExecute,
+	JitProtect_Read,
+} JitProtect;
+
+typedef struct JitMemoryMark {
+	isize used[JitSection_Count];
+} JitMemoryMark;
+
+// NOTE(khvorov) Stage 0 is a node that has not been looked at yet
+typedef struct LbWork {
+	AstExpr expr;
+	i32 stage;
+} LbWork;
+
+// NOTE(khvorov) A defined function when tiered compilation is on
+typedef struct TierFunction {
+	gbAtomicPtr entry; // NOTE(khvorov) Calls to the function load their target from here
+	u32 call_count;
+	b32 queued;
+	AstFunction *fun;
+	struct Tiering *tiering;
+} TierFunction;
+
+// NOTE(khvorov) A hot function generated into a context of its own, owned by
+// the background thread from here on. No function is the request to stop.
+typedef struct TierJob {
+	TierFunction *function;
+	LLVMContextRef ctx;
+	LLVMModuleRef module;
+	LLVMValueRef llvm_function;
+} TierJob;
+
+typedef struct Tiering {
+	gbThread thread;
+	gbSemaphore semaphore;
+	gbMutex mutex;
+	gbDynamicArray jobs; // NOTE(khvorov) TierJob, guarded by the mutex
+	isize jobs_head;
+	gbDynamicArray engines; // NOTE(khvorov) LLVMExecutionEngineRef, background thread only
+	gbDynamicArray contexts; // NOTE(khvorov) LLVMContextRef, background thread only
+	f64 compile_seconds; // NOTE(khvorov) Background thread only
+	gbHashTable functions; // NOTE(khvorov) Symbol -> TierFunction *
+	gbArena arena;
+	gbAllocator allocator;
+	AstPool *ast;
+	gbHashTable *function_protos;
+	LLVMExecutionEngineRef engine; // NOTE(khvorov) The main one, for its data layout
+} Tiering;
+
+typedef struct ScopeBinding {
+	Symbol name;
+	u32 shadowed; // NOTE(khvorov) Binding this one hides, as index + 1, or 0
+	LLVMValueRef slot;
+} ScopeBinding;
+
+GB_ARRAY_DEFINE(ScopeBinding)
+
+// NOTE(khvorov) Latest binding of a name, as index + 1. Only counts when the
+// generation is the table's current one.
+typedef struct ScopeHead {
+	u32 generation;
+	u32 binding;
+} ScopeHead;
+
+GB_HTAB_DEFINE(Symbol, ScopeHead, gb_htab_hash_int, gb_htab_eq)
+// NOTE(khvorov) What named_values was before scopes, for -bench-htab
+GB_HTAB_DEFINE(Symbol, LLVMValueRef, gb_htab_hash_int, gb_htab_eq)
+
+// NOTE(khvorov) Variables in scope. Bindings are a stack and each name's head
+// points at its innermost binding. Bumping the generation empties the table
+// without touching the heads.
+typedef struct ScopeTable {
+	gbHtab(Symbol, ScopeHead) heads;
+	gbArray(ScopeBinding) bindings;
+	gbArray(isize) frames; // NOTE(khvorov) bindings.len when each scope was pushed
+	u32 generation;
+} ScopeTable;
+
+// NOTE(khvorov) Optimized bitcode of definitions kept on disk between runs, one
+// file per definition named after its key
+typedef struct CompileCache {
+	char *dir;
+	u64 key_seed; // NOTE(khvorov) Optimization level and target
+	gbDynamicArray hash_stack; // NOTE(khvorov) AstExpr
+	gbRandom random;
+	gbAllocator allocator;
+	isize hits;
+	isize misses;
+	f64 saved_seconds;
+} CompileCache;
+
+typedef struct CompileCacheHeader {
+	u64 magic;
+	u64 key;
+	u64 bitcode_size;
+	f64 generate_seconds; // NOTE(khvorov) What a hit saves
+} CompileCacheHeader;
+
 typedef struct LLVMBackend {
 	LLVMContextRef ctx;
 	LLVMBuilderRef builder;
 	LLVMModuleRef module;
-	gbHashTable named_values;
+	LLVMExecutionEngineRef engine;
+	JitMemory jit_memory;
+	AstPool *ast;
+	gbDynamicArray work; // NOTE(khvorov) LbWork
+	gbDynamicArray values; // NOTE(khvorov) LLVMValueRef
+	gbDynamicArray unresolved; // NOTE(khvorov) AstFunction *, definitions the JIT has not compiled yet
+	isize anon_expr_count;
+	gbHashTable *function_protos; // NOTE(khvorov) Shared with the backends that recompile hot functions
+	b32 function_protos_read_only; // NOTE(khvorov) Codegen workers share the table with each other
+	ScopeTable named_values; // NOTE(khvorov) Symbol -> stack slot of the variable
+	LLVMBuilderRef alloca_builder;
+	LLVMPassManagerRef function_passes; // NOTE(khvorov) Bound to the current module
+	LLVMPassManagerRef module_passes; // NOTE(khvorov) Only at -O2 and up
+	i32 opt_level;
+	Tiering *tiering; // NOTE(khvorov) 0 when tiered compilation is off
+	TierFunction *optimizing; // NOTE(khvorov) Set when generating the optimized version of a function
+	CompileCache *cache; // NOTE(khvorov) 0 when there is no cache
 	gbArena arena;
 	gbAllocator arena_allocator;
 } LLVMBackend;
 
+#define LB_ANON_EXPR_NAME "__anon_expr"
+
+typedef void JobProc(void *data);
+
+typedef struct Job {
+	JobProc *proc;
+	void *data;
+	gbAtomic32 *counter; // NOTE(khvorov) Decremented once the job is done
+} Job;
+
+// NOTE(khvorov) Must be a power of 2
+#define JOB_DEQUE_SIZE 4096
+
+// NOTE(khvorov) Chase-Lev deque. The owner pushes and pops at the bottom,
+// other threads steal from the top.
+typedef struct JobDeque {
+	gbAtomic64 top;
+	gbAtomic64 bottom;
+	Job *jobs;
+} JobDeque;
+
+typedef struct JobWorker {
+	gbThread thread;
+	JobDeque deque;
+	struct JobSystem *system;
+	isize index;
+	u32 random;
+	isize jobs_run;
+	isize jobs_stolen;
+	b32 pinned;
+} JobWorker;
+
+// NOTE(khvorov) Worker 0 is the thread that created the system
+typedef struct JobSystem {
+	JobWorker *workers;
+	isize worker_count;
+	gbAtomic32 running;
+	gbAtomic32 sleeping;
+	gbSemaphore wake;
+	gbAffinity affinity;
+	gbAllocator allocator;
+} JobSystem;
+
+// NOTE(khvorov) Definitions shared out between the codegen workers
+typedef struct CodegenBatch {
+	LLVMBackend *lb; // NOTE(khvorov) The main one, read only while the workers run
+	AstFunction **functions;
+	isize function_count;
+	gbAtomic32 next_function;
+} CodegenBatch;
+
+typedef struct CodegenWorker {
+	CodegenBatch *batch;
+	gbAllocator allocator;
+	LLVMMemoryBufferRef bitcode; // NOTE(khvorov) The worker's module once it is done
+} CodegenWorker;
+
 
 static String
 string_from_cstring(char *ptr) {
@@ -192,15 +597,15 @@ string_cmp_cstring(String *str, char *cstring) {
 	while (index < str->len) {
 		char c1 = str->ptr[index];
 		char c2 = cstring[index];
-		if (c2 == '\0') {
-			break;
-		}
 		if (c2 != c1) {
 			result = false;
 			break;
 		}
 		index += 1;
 	}
+	if (cstring[index] != '\0') {
+		result = false;
+	}
 	return result;
 }
 
@@ -214,19 +619,28 @@ string_offset_to_next_line(String *str) {
 				to_skip += 1;
 			}
 			string_offset(str, to_skip, 0);
-			break;
+			return;
 		}
 	}
+	// NOTE(khvorov) Last line without a line break
+	string_offset(str, str->len, 0);
 }
 
+// NOTE(khvorov) Identifiers are nearly always under 16 bytes, where wyhash
+// takes a few loads and one multiply
+// NOTE(khvorov) Hash and compare procs take void * to match KeyHashProc and
+// KeyCmpProc
 static u64
-string_hash(String *str) {
-	u64 result = gb_murmur64(str->ptr, str->len);
+string_hash(void *key) {
+	String *str = key;
+	u64 result = gb_wyhash64(str->ptr, str->len);
 	return result;
 }
 
 static b32
-string_cmp(String *str1, String *str2) {
+string_cmp(void *key1, void *key2) {
+	String *str1 = key1;
+	String *str2 = key2;
 	b32 result = false;
 	if (str1->len == str2->len) {
 		result = true;
@@ -243,8 +657,107 @@ string_cmp(String *str1, String *str2) {
 }
 
 
+//
+// SECTION Symbols
+//
+
+gb_global SymbolTable global_symbols;
+
+#define SYMBOL_BLOCK_SIZE gb_kilobytes(64)
+
+static u64
+symbol_hash(void *key) {
+	Symbol *symbol = key;
+	u64 result = (u64)(*symbol) * 0x9E3779B97F4A7C15ull;
+	return result;
+}
+
+static b32
+symbol_cmp(void *key1, void *key2) {
+	b32 result = *(Symbol *)key1 == *(Symbol *)key2;
+	return result;
+}
+
+static void
+symbol_table_init(SymbolTable *table, gbAllocator allocator) {
+	gb_zero_item(table);
+	table->allocator = allocator;
+	gb_htab_init(&table->ids, allocator, sizeof(String), sizeof(Symbol), string_hash, string_cmp);
+	// NOTE(khvorov) Large inputs intern millions of names, growing all at once
+	// would stall the lexer for the whole table
+	table->ids.incremental_rehash = true;
+	gb_array_init(&table->names, allocator, sizeof(String));
+	String none = { "", 0 };
+	gb_array_append(&table->names, &none);
+}
+
+// NOTE(khvorov) Names are copied into blocks that are never moved or freed,
+// so the table does not depend on the lifetime of the source buffer
+static Symbol
+symbol_intern(SymbolTable *table, String *str) {
+	Symbol *existing = gb_htab_get(&table->ids, str);
+	Symbol result = 0;
+	if (existing != 0) {
+		result = *existing;
+	} else {
+		isize size = str->len + 1;
+		if (table->block_remaining < size) {
+			isize block_size = gb_max(size, SYMBOL_BLOCK_SIZE);
+			table->block = gb_alloc(table->allocator, block_size);
+			table->block_remaining = block_size;
+		}
+		String name = { table->block, str->len };
+		gb_memcopy(name.ptr, str->ptr, str->len);
+		name.ptr[str->len] = '\0';
+		table->block += size;
+		table->block_remaining -= size;
+
+		result = (Symbol)table->names.len;
+		gb_array_append(&table->names, &name);
+		gb_htab_set(&table->ids, &name, &result);
+	}
+	return result;
+}
+
+static Symbol
+symbol_intern_cstring(SymbolTable *table, char *cstring) {
+	String str = string_from_cstring(cstring);
+	Symbol result = symbol_intern(table, &str);
+	return result;
+}
+
+// NOTE(khvorov) Name of the function behind a user-defined operator, e.g. "binary|"
+static Symbol
+symbol_intern_operator(SymbolTable *table, char *prefix, char op) {
+	char name[16];
+	isize prefix_len = gb_strlen(prefix);
+	GB_ASSERT(prefix_len + 1 < gb_count_of(name));
+	gb_memcopy(name, prefix, prefix_len);
+	name[prefix_len] = op;
+	String str = { name, prefix_len + 1 };
+	Symbol result = symbol_intern(table, &str);
+	return result;
+}
+
+static String
+symbol_string(SymbolTable *table, Symbol symbol) {
+	String result = *(String *)gb_array_get(&table->names, symbol);
+	return result;
+}
+
+// NOTE(khvorov) Null-terminated
+static char *
+symbol_cstring(SymbolTable *table, Symbol symbol) {
+	char *result = symbol_string(table, symbol).ptr;
+	return result;
+}
+
+typedef Token GetTokenProc(String *input);
+
+// NOTE(khvorov) Byte-at-a-time lexer, kept to check and benchmark get_token against.
+// Interns identifiers and parses numbers like get_token so the two do the same work.
 static Token
-get_token(String *input) {
+get_token_reference(String *input) {
 	Token result = { 0 };
 
 	// NOTE(khvorov) Skip spaces and comments
@@ -271,14 +784,36 @@ get_token(String *input) {
 				result.type = TokenType_Def;
 			} else if (string_cmp_cstring(&result.identifier, "extern")) {
 				result.type = TokenType_Extern;
+			} else if (string_cmp_cstring(&result.identifier, "binary")) {
+				result.type = TokenType_Binary;
+			} else if (string_cmp_cstring(&result.identifier, "unary")) {
+				result.type = TokenType_Unary;
+			} else if (string_cmp_cstring(&result.identifier, "if")) {
+				result.type = TokenType_If;
+			} else if (string_cmp_cstring(&result.identifier, "then")) {
+				result.type = TokenType_Then;
+			} else if (string_cmp_cstring(&result.identifier, "else")) {
+				result.type = TokenType_Else;
+			} else if (string_cmp_cstring(&result.identifier, "for")) {
+				result.type = TokenType_For;
+			} else if (string_cmp_cstring(&result.identifier, "in")) {
+				result.type = TokenType_In;
+			} else if (string_cmp_cstring(&result.identifier, "var")) {
+				result.type = TokenType_Var;
 			} else {
 				result.type = TokenType_Identifier;
+				result.symbol = symbol_intern(&global_symbols, &result.identifier);
 			}
 
 		} else if (gb_char_is_digit(input->ptr[0])) {
 
+			// NOTE(khvorov) The input is not necessarily null-terminated
 			isize number_end = string_index_nonfloat(input);
-			result.number = strtod(input->ptr, 0);
+			char number_buffer[64];
+			isize number_len = gb_min(number_end, gb_count_of(number_buffer) - 1);
+			gb_memcopy(number_buffer, input->ptr, number_len);
+			number_buffer[number_len] = '\0';
+			result.number = strtod(number_buffer, 0);
 			string_offset(input, number_end, &result.identifier);
 
 			result.type = TokenType_Number;
@@ -286,453 +821,5159 @@ get_token(String *input) {
 		} else {
 			result.type = TokenType_Ascii;
 			result.ascii = input->ptr[0];
-			string_offset(input, 1, 0);
+			string_offset(input, 1, &result.identifier);
 		}
 	}
 
 	return result;
 }
 
-static i32
-get_cur_tok_precedence(AstParser *parser) {
-	i32 result = -1;
-
-	if (parser->token_count > 0 && parser->token->type == TokenType_Ascii) {
-		switch (parser->token->ascii) {
-		case '<': { result = 10; } break;
-		case '+': { result = 20; } break;
-		case '-': { result = 20; } break;
-		case '*': { result = 40; } break;
-		}
-	}
+//
+// SECTION Numbers
+//
 
+// NOTE(khvorov) 128-bit approximations of 5^q for q in [-342, 308], most
+// significant half first. Positive powers are truncated, negative ones are
+// rounded up, both normalized so the top bit is set.
+#define POWER_OF_FIVE_MIN -342
+#define POWER_OF_FIVE_MAX 308
+
+static u64 const POWER_OF_FIVE_128[POWER_OF_FIVE_MAX - POWER_OF_FIVE_MIN + 1][2] = {
+	{0xeef453d6923bd65aull, 0x113faa2906a13b3full},
+	{0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull},
+	{0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull},
+	{0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull},
+	{0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull},
+	{0xb64ec836a47146f9ull, 0x9748e2826cdee284ull},
+	{0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull},
+	{0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull},
+	{0xb208ef855c969f4full, 0xbdbd2d335e51a935ull},
+	{0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull},
+	{0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull},
+	{0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull},
+	{0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull},
+	{0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull},
+	{0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull},
+	{0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull},
+	{0x84a57695fe98746dull, 0x014bb630f7604b57ull},
+	{0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull},
+	{0xcf42894a5dce35eaull, 0x52064cac828675b9ull},
+	{0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull},
+	{0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull},
+	{0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull},
+	{0xfd00b897478238d0ull, 0x8920b098955522b4ull},
+	{0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull},
+	{0xc5a890362fddbc62ull, 0xeb2189f734aa831dull},
+	{0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull},
+	{0x9a6bb0aa55653b2dull, 0x47b233c92125366eull},
+	{0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull},
+	{0xf148440a256e2c76ull, 0xc00670ea43ca250dull},
+	{0x96cd2a865764dbcaull, 0x380406926a5e5728ull},
+	{0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull},
+	{0xeba09271e88d976bull, 0xf7864a44c633682eull},
+	{0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull},
+	{0xb8157268fdae9e4cull, 0x5960ea05bad82964ull},
+	{0xe61acf033d1a45dfull, 0x6fb92487298e33bdull},
+	{0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull},
+	{0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull},
+	{0xe0b62e2929aba83cull, 0x331acdabfe94de87ull},
+	{0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull},
+	{0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull},
+	{0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull},
+	{0x892731ac9faf056eull, 0xbe311c083a225cd2ull},
+	{0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull},
+	{0xd64d3d9db981787dull, 0x092cbbccdad5b108ull},
+	{0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull},
+	{0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull},
+	{0xd1476e2c07286faaull, 0x1af5af660db4aee1ull},
+	{0x82cca4db847945caull, 0x50d98d9fc890ed4dull},
+	{0xa37fce126597973cull, 0xe50ff107bab528a0ull},
+	{0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull},
+	{0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull},
+	{0x9faacf3df73609b1ull, 0x77b191618c54e9acull},
+	{0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull},
+	{0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull},
+	{0x9becce62836ac577ull, 0x4ee367f9430aec32ull},
+	{0xc2e801fb244576d5ull, 0x229c41f793cda73full},
+	{0xf3a20279ed56d48aull, 0x6b43527578c1110full},
+	{0x9845418c345644d6ull, 0x830a13896b78aaa9ull},
+	{0xbe5691ef416bd60cull, 0x23cc986bc656d553ull},
+	{0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull},
+	{0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull},
+	{0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull},
+	{0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull},
+	{0x91376c36d99995beull, 0x23100809b9c21fa1ull},
+	{0xb58547448ffffb2dull, 0xabd40a0c2832a78aull},
+	{0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull},
+	{0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull},
+	{0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull},
+	{0xdd95317f31c7fa1dull, 0x40405643d711d583ull},
+	{0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull},
+	{0xad1c8eab5ee43b66ull, 0xda3243650005eecfull},
+	{0xd863b256369d4a40ull, 0x90bed43e40076a82ull},
+	{0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull},
+	{0xa90de3535aaae202ull, 0x711515d0a205cb36ull},
+	{0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull},
+	{0x8412d9991ed58091ull, 0xe858790afe9486c2ull},
+	{0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull},
+	{0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full},
+	{0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull},
+	{0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull},
+	{0xc987434744ac874eull, 0xa327ffb266b56220ull},
+	{0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull},
+	{0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull},
+	{0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull},
+	{0xf6019da07f549b2bull, 0x7e2a53a146606a48ull},
+	{0x99c102844f94e0fbull, 0x2eda7444cbfc426dull},
+	{0xc0314325637a1939ull, 0xfa911155fefb5308ull},
+	{0xf03d93eebc589f88ull, 0x793555ab7eba27caull},
+	{0x96267c7535b763b5ull, 0x4bc1558b2f3458deull},
+	{0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull},
+	{0xea9c227723ee8bcbull, 0x465e15a979c1cadcull},
+	{0x92a1958a7675175full, 0x0bfacd89ec191ec9ull},
+	{0xb749faed14125d36ull, 0xcef980ec671f667bull},
+	{0xe51c79a85916f484ull, 0x82b7e12780e7401aull},
+	{0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull},
+	{0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull},
+	{0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull},
+	{0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull},
+	{0xaecc49914078536dull, 0x58fae9f773886e18ull},
+	{0xda7f5bf590966848ull, 0xaf39a475506a899eull},
+	{0x888f99797a5e012dull, 0x6d8406c952429603ull},
+	{0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull},
+	{0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull},
+	{0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full},
+	{0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull},
+	{0xd0601d8efc57b08bull, 0xf13b94daf124da26ull},
+	{0x823c12795db6ce57ull, 0x76c53d08d6b70858ull},
+	{0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull},
+	{0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull},
+	{0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull},
+	{0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull},
+	{0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull},
+	{0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull},
+	{0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull},
+	{0xc21094364dfb5636ull, 0x985915fc12f542e4ull},
+	{0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull},
+	{0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull},
+	{0xbd8430bd08277231ull, 0x50c6ff782a838353ull},
+	{0xece53cec4a314ebdull, 0xa4f8bf5635246428ull},
+	{0x940f4613ae5ed136ull, 0x871b7795e136be99ull},
+	{0xb913179899f68584ull, 0x28e2557b59846e3full},
+	{0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull},
+	{0x9096ea6f3848984full, 0x3ff0d2c85def7621ull},
+	{0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull},
+	{0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull},
+	{0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull},
+	{0xb080392cc4349decull, 0xbd8d794d96aacfb3ull},
+	{0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull},
+	{0x89e42caaf9491b60ull, 0xf41686c49db57244ull},
+	{0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull},
+	{0xd77485cb25823ac7ull, 0x7d633293366b828bull},
+	{0x86a8d39ef77164bcull, 0xae5dff9c02033197ull},
+	{0xa8530886b54dbdebull, 0xd9f57f830283fdfcull},
+	{0xd267caa862a12d66ull, 0xd072df63c324fd7bull},
+	{0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull},
+	{0xa46116538d0deb78ull, 0x52d9be85f074e608ull},
+	{0xcd795be870516656ull, 0x67902e276c921f8bull},
+	{0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull},
+	{0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull},
+	{0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull},
+	{0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull},
+	{0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull},
+	{0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull},
+	{0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull},
+	{0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull},
+	{0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull},
+	{0xef340a98172aace4ull, 0x86fb897116c87c34ull},
+	{0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull},
+	{0xbae0a846d2195712ull, 0x8974836059cca109ull},
+	{0xe998d258869facd7ull, 0x2bd1a438703fc94bull},
+	{0x91ff83775423cc06ull, 0x7b6306a34627ddcfull},
+	{0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull},
+	{0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull},
+	{0x8e938662882af53eull, 0x547eb47b7282ee9cull},
+	{0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull},
+	{0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull},
+	{0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull},
+	{0xae0b158b4738705eull, 0x9624ab50b148d445ull},
+	{0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull},
+	{0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull},
+	{0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull},
+	{0xd47487cc8470652bull, 0x7647c3200069671full},
+	{0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull},
+	{0xa5fb0a17c777cf09ull, 0xf468107100525890ull},
+	{0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull},
+	{0x81ac1fe293d599bfull, 0xc6f14cd848405530ull},
+	{0xa21727db38cb002full, 0xb8ada00e5a506a7cull},
+	{0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull},
+	{0xfd442e4688bd304aull, 0x908f4a166d1da663ull},
+	{0x9e4a9cec15763e2eull, 0x9a598e4e043287feull},
+	{0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull},
+	{0xf7549530e188c128ull, 0xd12bee59e68ef47cull},
+	{0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull},
+	{0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull},
+	{0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull},
+	{0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull},
+	{0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull},
+	{0xebdf661791d60f56ull, 0x111b495b3464ad21ull},
+	{0x936b9fcebb25c995ull, 0xcab10dd900beec34ull},
+	{0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull},
+	{0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull},
+	{0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull},
+	{0xb3f4e093db73a093ull, 0x59ed216765690f56ull},
+	{0xe0f218b8d25088b8ull, 0x306869c13ec3532cull},
+	{0x8c974f7383725573ull, 0x1e414218c73a13fbull},
+	{0xafbd2350644eeacfull, 0xe5d1929ef90898faull},
+	{0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull},
+	{0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull},
+	{0xab9eb47c81f5114full, 0x066ea92f3f326564ull},
+	{0xd686619ba27255a2ull, 0xc80a537b0efefebdull},
+	{0x8613fd0145877585ull, 0xbd06742ce95f5f36ull},
+	{0xa798fc4196e952e7ull, 0x2c48113823b73704ull},
+	{0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull},
+	{0x82ef85133de648c4ull, 0x9a984d73dbe722fbull},
+	{0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull},
+	{0xcc963fee10b7d1b3ull, 0x318df905079926a8ull},
+	{0xffbbcfe994e5c61full, 0xfdf17746497f7052ull},
+	{0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull},
+	{0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull},
+	{0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull},
+	{0x9c1661a651213e2dull, 0x06bea10ca65c084eull},
+	{0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull},
+	{0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull},
+	{0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull},
+	{0xbe89523386091465ull, 0xf6bbb397f1135823ull},
+	{0xee2ba6c0678b597full, 0x746aa07ded582e2cull},
+	{0x94db483840b717efull, 0xa8c2a44eb4571cdcull},
+	{0xba121a4650e4ddebull, 0x92f34d62616ce413ull},
+	{0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull},
+	{0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull},
+	{0xb5b5ada8aaff80b8ull, 0x0d819992132456baull},
+	{0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull},
+	{0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull},
+	{0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull},
+	{0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull},
+	{0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull},
+	{0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull},
+	{0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull},
+	{0x87625f056c7c4a8bull, 0x11471cd764ad4972ull},
+	{0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull},
+	{0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull},
+	{0x843610cb4bf160cbull, 0xcedf722a585139baull},
+	{0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull},
+	{0xce947a3da6a9273eull, 0x733d226229feea32ull},
+	{0x811ccc668829b887ull, 0x0806357d5a3f525full},
+	{0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull},
+	{0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull},
+	{0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull},
+	{0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull},
+	{0xc5029163f384a931ull, 0x0a9e795e65d4df11ull},
+	{0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull},
+	{0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull},
+	{0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull},
+	{0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull},
+	{0x964e858c91ba2655ull, 0x3a6a07f8d510f86full},
+	{0xbbe226efb628afeaull, 0x890489f70a55368bull},
+	{0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull},
+	{0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull},
+	{0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull},
+	{0xe55990879ddcaabdull, 0xcc420a6a101d0515ull},
+	{0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull},
+	{0xb32df8e9f3546564ull, 0x47939822dc96abf9ull},
+	{0xdff9772470297ebdull, 0x59787e2b93bc56f7ull},
+	{0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull},
+	{0xaefae51477a06b03ull, 0xede622920b6b23f1ull},
+	{0xdab99e59958885c4ull, 0xe95fab368e45ecedull},
+	{0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull},
+	{0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull},
+	{0xd59944a37c0752a2ull, 0x4be76d3346f0495full},
+	{0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull},
+	{0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull},
+	{0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull},
+	{0x825ecc24c873782full, 0x8ed400668c0c28c8ull},
+	{0xa2f67f2dfa90563bull, 0x728900802f0f32faull},
+	{0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull},
+	{0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull},
+	{0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull},
+	{0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull},
+	{0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull},
+	{0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull},
+	{0xc24452da229b021bull, 0xfbe85badce996168ull},
+	{0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull},
+	{0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull},
+	{0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull},
+	{0xed246723473e3813ull, 0x290123e9aab23b68ull},
+	{0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull},
+	{0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull},
+	{0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull},
+	{0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull},
+	{0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull},
+	{0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull},
+	{0x8d590723948a535full, 0x579c487e5a38ad0eull},
+	{0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull},
+	{0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull},
+	{0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull},
+	{0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full},
+	{0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full},
+	{0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull},
+	{0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull},
+	{0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull},
+	{0x83a3eeeef9153e89ull, 0x1953cf68300424acull},
+	{0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull},
+	{0xcdb02555653131b6ull, 0x3792f412cb06794dull},
+	{0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull},
+	{0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull},
+	{0xc8de047564d20a8bull, 0xf245825a5a445275ull},
+	{0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull},
+	{0x9ced737bb6c4183dull, 0x55464dd69685606bull},
+	{0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull},
+	{0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull},
+	{0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull},
+	{0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull},
+	{0xef73d256a5c0f77cull, 0x963e66858f6d4440ull},
+	{0x95a8637627989aadull, 0xdde7001379a44aa8ull},
+	{0xbb127c53b17ec159ull, 0x5560c018580d5d52ull},
+	{0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull},
+	{0x9226712162ab070dull, 0xcab3961304ca70e8ull},
+	{0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull},
+	{0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull},
+	{0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull},
+	{0xb267ed1940f1c61cull, 0x55f038b237591ed3ull},
+	{0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull},
+	{0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull},
+	{0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull},
+	{0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull},
+	{0x881cea14545c7575ull, 0x7e50d64177da2e54ull},
+	{0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull},
+	{0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull},
+	{0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull},
+	{0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull},
+	{0xcfb11ead453994baull, 0x67de18eda5814af2ull},
+	{0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull},
+	{0xa2425ff75e14fc31ull, 0xa1258379a94d028dull},
+	{0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull},
+	{0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull},
+	{0x9e74d1b791e07e48ull, 0x775ea264cf55347eull},
+	{0xc612062576589ddaull, 0x95364afe032a819eull},
+	{0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull},
+	{0x9abe14cd44753b52ull, 0xc4926a9672793543ull},
+	{0xc16d9a0095928a27ull, 0x75b7053c0f178294ull},
+	{0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull},
+	{0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull},
+	{0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull},
+	{0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull},
+	{0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull},
+	{0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull},
+	{0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull},
+	{0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull},
+	{0xb424dc35095cd80full, 0x538484c19ef38c95ull},
+	{0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull},
+	{0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull},
+	{0xafebff0bcb24aafeull, 0xf78f69a51539d749ull},
+	{0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull},
+	{0x89705f4136b4a597ull, 0x31680a88f8953031ull},
+	{0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull},
+	{0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull},
+	{0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull},
+	{0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull},
+	{0xd1b71758e219652bull, 0xd3c36113404ea4a9ull},
+	{0x83126e978d4fdf3bull, 0x645a1cac083126eaull},
+	{0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull},
+	{0xccccccccccccccccull, 0xcccccccccccccccdull},
+	{0x8000000000000000ull, 0x0000000000000000ull},
+	{0xa000000000000000ull, 0x0000000000000000ull},
+	{0xc800000000000000ull, 0x0000000000000000ull},
+	{0xfa00000000000000ull, 0x0000000000000000ull},
+	{0x9c40000000000000ull, 0x0000000000000000ull},
+	{0xc350000000000000ull, 0x0000000000000000ull},
+	{0xf424000000000000ull, 0x0000000000000000ull},
+	{0x9896800000000000ull, 0x0000000000000000ull},
+	{0xbebc200000000000ull, 0x0000000000000000ull},
+	{0xee6b280000000000ull, 0x0000000000000000ull},
+	{0x9502f90000000000ull, 0x0000000000000000ull},
+	{0xba43b74000000000ull, 0x0000000000000000ull},
+	{0xe8d4a51000000000ull, 0x0000000000000000ull},
+	{0x9184e72a00000000ull, 0x0000000000000000ull},
+	{0xb5e620f480000000ull, 0x0000000000000000ull},
+	{0xe35fa931a0000000ull, 0x0000000000000000ull},
+	{0x8e1bc9bf04000000ull, 0x0000000000000000ull},
+	{0xb1a2bc2ec5000000ull, 0x0000000000000000ull},
+	{0xde0b6b3a76400000ull, 0x0000000000000000ull},
+	{0x8ac7230489e80000ull, 0x0000000000000000ull},
+	{0xad78ebc5ac620000ull, 0x0000000000000000ull},
+	{0xd8d726b7177a8000ull, 0x0000000000000000ull},
+	{0x878678326eac9000ull, 0x0000000000000000ull},
+	{0xa968163f0a57b400ull, 0x0000000000000000ull},
+	{0xd3c21bcecceda100ull, 0x0000000000000000ull},
+	{0x84595161401484a0ull, 0x0000000000000000ull},
+	{0xa56fa5b99019a5c8ull, 0x0000000000000000ull},
+	{0xcecb8f27f4200f3aull, 0x0000000000000000ull},
+	{0x813f3978f8940984ull, 0x4000000000000000ull},
+	{0xa18f07d736b90be5ull, 0x5000000000000000ull},
+	{0xc9f2c9cd04674edeull, 0xa400000000000000ull},
+	{0xfc6f7c4045812296ull, 0x4d00000000000000ull},
+	{0x9dc5ada82b70b59dull, 0xf020000000000000ull},
+	{0xc5371912364ce305ull, 0x6c28000000000000ull},
+	{0xf684df56c3e01bc6ull, 0xc732000000000000ull},
+	{0x9a130b963a6c115cull, 0x3c7f400000000000ull},
+	{0xc097ce7bc90715b3ull, 0x4b9f100000000000ull},
+	{0xf0bdc21abb48db20ull, 0x1e86d40000000000ull},
+	{0x96769950b50d88f4ull, 0x1314448000000000ull},
+	{0xbc143fa4e250eb31ull, 0x17d955a000000000ull},
+	{0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull},
+	{0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull},
+	{0xb7abc627050305adull, 0xf14a3d9e40000000ull},
+	{0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull},
+	{0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull},
+	{0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull},
+	{0xe0352f62a19e306eull, 0xd50b2037ad200000ull},
+	{0x8c213d9da502de45ull, 0x4526f422cc340000ull},
+	{0xaf298d050e4395d6ull, 0x9670b12b7f410000ull},
+	{0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull},
+	{0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull},
+	{0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull},
+	{0xd5d238a4abe98068ull, 0x72a4904598d6d880ull},
+	{0x85a36366eb71f041ull, 0x47a6da2b7f864750ull},
+	{0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull},
+	{0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull},
+	{0x82818f1281ed449full, 0xbff8f10e7a8921a4ull},
+	{0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull},
+	{0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull},
+	{0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull},
+	{0x9f4f2726179a2245ull, 0x01d762422c946590ull},
+	{0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull},
+	{0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull},
+	{0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full},
+	{0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull},
+	{0xf316271c7fc3908aull, 0x8bef464e3945ef7aull},
+	{0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull},
+	{0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull},
+	{0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull},
+	{0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull},
+	{0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull},
+	{0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull},
+	{0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull},
+	{0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull},
+	{0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull},
+	{0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull},
+	{0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull},
+	{0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull},
+	{0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull},
+	{0xacb92ed9397bf996ull, 0x49c2c37f07965404ull},
+	{0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull},
+	{0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull},
+	{0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull},
+	{0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull},
+	{0x83c7088e1aab65dbull, 0x792667c6da79e0faull},
+	{0xa4b8cab1a1563f52ull, 0x577001b891185938ull},
+	{0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull},
+	{0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull},
+	{0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull},
+	{0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull},
+	{0xfb5878494ace3a5full, 0x04ab48a04065c723ull},
+	{0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull},
+	{0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull},
+	{0xf5746577930d6500ull, 0xca8f44ec7ee36479ull},
+	{0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull},
+	{0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull},
+	{0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull},
+	{0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull},
+	{0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull},
+	{0xea1575143cf97226ull, 0xf52d09d71a3293bdull},
+	{0x924d692ca61be758ull, 0x593c2626705f9c56ull},
+	{0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull},
+	{0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull},
+	{0x8edf98b59a373fecull, 0x4724bd4189bd5eacull},
+	{0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull},
+	{0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull},
+	{0x8b865b215899f46cull, 0xbd79e0d20082ee74ull},
+	{0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull},
+	{0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull},
+	{0x884134fe908658b2ull, 0x3109058d147fdcddull},
+	{0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull},
+	{0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull},
+	{0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull},
+	{0xa6539930bf6bff45ull, 0x84db8346b786151cull},
+	{0xcfe87f7cef46ff16ull, 0xe612641865679a63ull},
+	{0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull},
+	{0xa26da3999aef7749ull, 0xe3be5e330f38f09dull},
+	{0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull},
+	{0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull},
+	{0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull},
+	{0xc646d63501a1511dull, 0xb281e1fd541501b8ull},
+	{0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull},
+	{0x9ae757596946075full, 0x3375788de9b06958ull},
+	{0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull},
+	{0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull},
+	{0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull},
+	{0xbd176620a501fbffull, 0xb650e5a93bc3d898ull},
+	{0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull},
+	{0x93ba47c980e98cdfull, 0xc66f336c36b10137ull},
+	{0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull},
+	{0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull},
+	{0x9043ea1ac7e41392ull, 0x87c89837ad68db2full},
+	{0xb454e4a179dd1877ull, 0x29babe4598c311fbull},
+	{0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull},
+	{0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull},
+	{0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full},
+	{0xdc21a1171d42645dull, 0x76707543f4fa1f73ull},
+	{0x899504ae72497ebaull, 0x6a06494a791c53a8ull},
+	{0xabfa45da0edbde69ull, 0x0487db9d17636892ull},
+	{0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull},
+	{0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull},
+	{0xa7f26836f282b732ull, 0x8e6cac7768d7141eull},
+	{0xd1ef0244af2364ffull, 0x3207d795430cd926ull},
+	{0x8335616aed761f1full, 0x7f44e6bd49e807b8ull},
+	{0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull},
+	{0xcd036837130890a1ull, 0x36dba887c37a8c0full},
+	{0x802221226be55a64ull, 0xc2494954da2c9789ull},
+	{0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull},
+	{0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull},
+	{0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull},
+	{0x9c69a97284b578d7ull, 0xff2a760414536efbull},
+	{0xc38413cf25e2d70dull, 0xfef5138519684abaull},
+	{0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull},
+	{0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull},
+	{0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull},
+	{0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull},
+	{0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull},
+	{0xba756174393d88dfull, 0x94f971119aeef9e4ull},
+	{0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull},
+	{0x91abb422ccb812eeull, 0xac62e055c10ab33aull},
+	{0xb616a12b7fe617aaull, 0x577b986b314d6009ull},
+	{0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull},
+	{0x8e41ade9fbebc27dull, 0x14588f13be847307ull},
+	{0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull},
+	{0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull},
+	{0x8aec23d680043beeull, 0x25de7bb9480d5854ull},
+	{0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull},
+	{0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull},
+	{0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull},
+	{0xa99541bf57452b28ull, 0x353a1607ac744a53ull},
+	{0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull},
+	{0x847c9b5d7c2e09b7ull, 0x69956135febada11ull},
+	{0xa59bc234db398c25ull, 0x43fab9837e699095ull},
+	{0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull},
+	{0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull},
+	{0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull},
+	{0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull},
+	{0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull},
+	{0x9defbf01b061adabull, 0x3a0888136afa64a7ull},
+	{0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull},
+	{0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull},
+	{0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull},
+	{0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull},
+	{0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull},
+	{0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull},
+	{0xbc4665b596706114ull, 0x873d5d9f0dde1feeull},
+	{0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull},
+	{0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull},
+	{0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full},
+	{0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull},
+	{0x8fa475791a569d10ull, 0xf96e017d694487bcull},
+	{0xb38d92d760ec4455ull, 0x37c981dcc395a9acull},
+	{0xe070f78d3927556aull, 0x85bbe253f47b1417ull},
+	{0x8c469ab843b89562ull, 0x93956d7478ccec8eull},
+	{0xaf58416654a6babbull, 0x387ac8d1970027b2ull},
+	{0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull},
+	{0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull},
+	{0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull},
+	{0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull},
+	{0x85c7056562757456ull, 0xf6872d5667844e49ull},
+	{0xa738c6bebb12d16cull, 0xb428f8ac016561dbull},
+	{0xd106f86e69d785c7ull, 0xe13336d701beba52ull},
+	{0x82a45b450226b39cull, 0xecc0024661173473ull},
+	{0xa34d721642b06084ull, 0x27f002d7f95d0190ull},
+	{0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull},
+	{0xff290242c83396ceull, 0x7e67047175a15271ull},
+	{0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull},
+	{0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull},
+	{0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull},
+	{0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull},
+	{0xc2abf989935ddbfeull, 0x6acff893d00ea435ull},
+	{0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull},
+	{0x98165af37b2153deull, 0xc3727a337a8b704aull},
+	{0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull},
+	{0xeda2ee1c7064130cull, 0x1162def06f79df73ull},
+	{0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull},
+	{0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull},
+	{0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull},
+	{0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull},
+	{0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull},
+	{0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull},
+	{0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull},
+	{0xb10d8e1456105dadull, 0x7425a83e872c5f47ull},
+	{0xdd50f1996b947518ull, 0xd12f124e28f77719ull},
+	{0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full},
+	{0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull},
+	{0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull},
+	{0x8714a775e3e95c78ull, 0x65acfaec34810a71ull},
+	{0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull},
+	{0xd31045a8341ca07cull, 0x1ede48111209a050ull},
+	{0x83ea2b892091e44dull, 0x934aed0aab460432ull},
+	{0xa4e4b66b68b65d60ull, 0xf81da84d5617853full},
+	{0xce1de40642e3f4b9ull, 0x36251260ab9d668eull},
+	{0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull},
+	{0xa1075a24e4421730ull, 0xb24cf65b8612f81full},
+	{0xc94930ae1d529cfcull, 0xdee033f26797b627ull},
+	{0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull},
+	{0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull},
+	{0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull},
+	{0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull},
+	{0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull},
+	{0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull},
+	{0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull},
+	{0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull},
+	{0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull},
+	{0xea53df5fd18d5513ull, 0x84c86189216dc5edull},
+	{0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull},
+	{0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull},
+	{0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull},
+	{0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull},
+	{0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull},
+	{0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull},
+	{0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull},
+	{0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull},
+	{0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull},
+	{0x8865899617fb1871ull, 0x7e2fa67c7a658892ull},
+	{0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull},
+	{0xd51ea6fa85785631ull, 0x552a74227f3ea565ull},
+	{0x8533285c936b35deull, 0xd53a88958f87275full},
+	{0xa67ff273b8460356ull, 0x8a892abaf368f137ull},
+	{0xd01fef10a657842cull, 0x2d2b7569b0432d85ull},
+	{0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull},
+	{0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full},
+	{0xcb3f2f7642717713ull, 0x241c70a936219a73ull},
+	{0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull},
+	{0x9ec95d1463e8a506ull, 0xf4363804324a40aaull},
+	{0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull},
+	{0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull},
+	{0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull},
+	{0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull},
+	{0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull},
+	{0x976e41088617ca01ull, 0xd5be0503e085d813ull},
+	{0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull},
+	{0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull},
+	{0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull},
+	{0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull},
+	{0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull},
+	{0x906a617d450187e2ull, 0x27fb2b80668b24c5ull},
+	{0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull},
+	{0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull},
+	{0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull},
+	{0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull},
+	{0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull},
+	{0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull},
+	{0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull},
+	{0xd732290fbacaf133ull, 0xa97c177947ad4095ull},
+	{0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull},
+	{0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull},
+	{0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull},
+	{0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull},
+	{0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull},
+	{0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull},
+	{0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull},
+	{0xa0555e361951c366ull, 0xd7e105bcc332621full},
+	{0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull},
+	{0xfa856334878fc150ull, 0xb14f98f6f0feb951ull},
+	{0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull},
+	{0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull},
+	{0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull},
+	{0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull},
+	{0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull},
+	{0xeeea5d5004981478ull, 0x1858ccfce06cac74ull},
+	{0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull},
+	{0xbaa718e68396cffdull, 0xd30560258f54e6baull},
+	{0xe950df20247c83fdull, 0x47c6b82ef32a2069ull},
+	{0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull},
+	{0xb6472e511c81471dull, 0xe0133fe4adf8e952ull},
+	{0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull},
+	{0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull},
+};
+
+typedef struct U128 {
+	u64 hi;
+	u64 lo;
+} U128;
+
+static U128
+u64_mul_full(u64 a, u64 b) {
+	U128 result;
+	result.lo = gb_mul_u64_full(a, b, &result.hi);
 	return result;
 }
 
-
-static void
-parser_advance(AstParser *parser) {
-	GB_ASSERT(parser->token_count > 0);
-	parser->token += 1;
-	parser->token_count -= 1;
+// NOTE(khvorov) value must not be 0
+static i32
+u64_count_leading_zeros(u64 value) {
+#if defined(GB_COMPILER_MSVC) && defined(_M_X64)
+	unsigned long index = 0;
+	_BitScanReverse64(&index, value);
+	return 63 - (i32)index;
+#elif defined(GB_COMPILER_MSVC)
+	i32 result = 0;
+	while ((value & (1ull << 63)) == 0) {
+		value <<= 1;
+		result += 1;
+	}
+	return result;
+#else
+	return __builtin_clzll(value);
+#endif
 }
 
-static AstNode *
-parse_number(AstParser *parser) {
-	Token *token = parser->token;
-	GB_ASSERT(token->type == TokenType_Number);
-	AstNode *num_node = gb_alloc_item(parser->arena_allocator, AstNode);
-	num_node->type = AstType_Number;
-	num_node->number.val = token->number;
-	parser_advance(parser);
-	return num_node;
+static f64
+f64_from_bits(u64 bits) {
+	f64 result;
+	gb_memcopy(&result, &bits, sizeof(result));
+	return result;
 }
 
-static AstNode *parse_primary(AstParser *parser);
-static AstNode *parse_binop_rhs(AstParser *parser, i32 precedence, AstNode *lhs);
+static f64 const F64_EXACT_POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
 
-static AstNode *
-parse_expr(AstParser *parser) {
-	AstNode *lhs = parse_primary(parser);
-	AstNode *result = parse_binop_rhs(parser, 0, lhs);
+// NOTE(khvorov) Eisel-Lemire. Computes the correctly rounded w * 10^q with
+// w != 0 and returns the bits of the f64. Follows fast_float, which proves
+// the 128-bit product is always enough for a 64-bit w.
+static u64
+f64_bits_from_decimal(u64 w, i64 q) {
+	u64 result = 0;
+	if (q < POWER_OF_FIVE_MIN) {
+		result = 0;
+	} else if (q > POWER_OF_FIVE_MAX) {
+		result = 0x7FFull << 52;
+	} else {
+		i32 leading_zeros = u64_count_leading_zeros(w);
+		w <<= leading_zeros;
+
+		// NOTE(khvorov) 52 explicit mantissa bits plus 3 for rounding
+		u64 const precision_mask = 0xFFFFFFFFFFFFFFFFull >> 55;
+		u64 const *power = POWER_OF_FIVE_128[q - POWER_OF_FIVE_MIN];
+		U128 product = u64_mul_full(w, power[0]);
+		if ((product.hi & precision_mask) == precision_mask) {
+			U128 product_low = u64_mul_full(w, power[1]);
+			product.lo += product_low.hi;
+			if (product_low.hi > product.lo) {
+				product.hi += 1;
+			}
+		}
+
+		i32 upper_bit = (i32)(product.hi >> 63);
+		i32 shift = upper_bit + 64 - 52 - 3;
+		u64 mantissa = product.hi >> shift;
+		// NOTE(khvorov) floor(log2(10^q)) + 63, 1023 is the exponent bias
+		i64 power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - leading_zeros + 1023;
+
+		if (power2 <= 0) {
+			if (-power2 + 1 >= 64) {
+				result = 0;
+			} else {
+				mantissa >>= -power2 + 1;
+				mantissa += mantissa & 1;
+				mantissa >>= 1;
+				// NOTE(khvorov) Rounding up can make it the smallest normal number
+				result = mantissa;
+			}
+		} else {
+			// NOTE(khvorov) Exactly halfway between two f64s, round to even
+			if (product.lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+				if ((mantissa << shift) == product.hi) {
+					mantissa &= ~1ull;
+				}
+			}
+			mantissa += mantissa & 1;
+			mantissa >>= 1;
+			if (mantissa >= (2ull << 52)) {
+				mantissa = 1ull << 52;
+				power2 += 1;
+			}
+			mantissa &= ~(1ull << 52);
+			if (power2 >= 0x7FF) {
+				result = 0x7FFull << 52;
+			} else {
+				result = mantissa | ((u64)power2 << 52);
+			}
+		}
+	}
 	return result;
 }
 
-static AstNode *
-parse_paren(AstParser *parser) {
-	GB_ASSERT(parser->token->type == TokenType_Ascii);
-	GB_ASSERT(parser->token->ascii == '(');
-	parser_advance(parser);
+#define F64_MAX_DIGITS 19
+#define F64_SLOW_BUFFER_SIZE 800
+
+// NOTE(khvorov) More than 19 significant digits and the truncated and rounded
+// up mantissas disagree. Rare enough to hand to strtod on a bounded copy,
+// digits past the buffer only matter as a sticky nonzero.
+static f64
+string_to_f64_slow(String str) {
+	char buffer[F64_SLOW_BUFFER_SIZE];
+	isize copy_len = gb_min(str.len, gb_count_of(buffer) - 2);
+	gb_memcopy(buffer, str.ptr, copy_len);
+	for (isize index = copy_len; index < str.len; index += 1) {
+		if (str.ptr[index] != '0' && str.ptr[index] != '.') {
+			buffer[copy_len] = '1';
+			copy_len += 1;
+			break;
+		}
+	}
+	buffer[copy_len] = '\0';
+	f64 result = strtod(buffer, 0);
+	return result;
+}
 
-	AstNode *expr = parse_expr(parser);
+// NOTE(khvorov) str is a run of digits and dots starting with a digit.
+// Like strtod, everything from the second dot on is ignored.
+static f64
+string_to_f64(String str) {
+	u64 mantissa = 0;
+	i64 exponent = 0;
+	isize significant_digits = 0;
+	b32 truncated = false;
+	b32 seen_dot = false;
 
-	GB_ASSERT(parser->token->type == TokenType_Ascii);
-	GB_ASSERT(parser->token->ascii == ')');
-	parser_advance(parser);
+	isize index = 0;
+	for (; index < str.len; index += 1) {
+		char ch = str.ptr[index];
+		if (ch == '.') {
+			if (seen_dot) {
+				break;
+			}
+			seen_dot = true;
+		} else {
+			u64 digit = (u64)(ch - '0');
+			if (significant_digits < F64_MAX_DIGITS) {
+				mantissa = mantissa * 10 + digit;
+				if (mantissa != 0) {
+					significant_digits += 1;
+				}
+				exponent -= seen_dot;
+			} else {
+				truncated |= digit != 0;
+				exponent += !seen_dot;
+			}
+		}
+	}
 
-	return expr;
+	f64 result = 0;
+	if (mantissa == 0) {
+		result = 0;
+	} else if (!truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		// NOTE(khvorov) Both operands are exact so one rounding gives the right answer
+		if (exponent < 0) {
+			result = (f64)mantissa / F64_EXACT_POWERS_OF_TEN[-exponent];
+		} else {
+			result = (f64)mantissa * F64_EXACT_POWERS_OF_TEN[exponent];
+		}
+	} else {
+		u64 bits = f64_bits_from_decimal(mantissa, exponent);
+		if (truncated && bits != f64_bits_from_decimal(mantissa + 1, exponent)) {
+			str.len = index;
+			result = string_to_f64_slow(str);
+		} else {
+			result = f64_from_bits(bits);
+		}
+	}
+	return result;
 }
 
-static AstNode *
-parse_iden(AstParser *parser) {
-	GB_ASSERT(parser->token->type == TokenType_Identifier);
-	String name = parser->token->identifier;
-	parser_advance(parser);
+//
+// SECTION Lexer
+//
 
-	AstNode *result = gb_alloc_item(parser->arena_allocator, AstNode);
-	if (parser->token->type != TokenType_Ascii || parser->token->ascii != '(') {
-		result->type = AstType_Variable;
-		result->variable.name = name;
-	} else {
+typedef enum CharClass {
+	CharClass_Space = GB_BIT(0),
+	CharClass_Alpha = GB_BIT(1),
+	CharClass_Digit = GB_BIT(2),
+	CharClass_Float = GB_BIT(3),
+	CharClass_Newline = GB_BIT(4),
+
+	CharClass_Alphanum = CharClass_Alpha | CharClass_Digit,
+} CharClass;
+
+gb_global u8 const LEXER_CHAR_CLASS[256] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x11, 0x01, 0x01, 0x11, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00,
+	0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+	0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+	0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define LEXER_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define LEXER_SSE2 0
+#endif
 
-		parser_advance(parser);
-		result->type = AstType_Call;
-		result->call.callee = name;
-		result->call.args = 0;
-		result->call.arg_count = 0;
+#if LEXER_SSE2
+// NOTE(khvorov) mask must not be 0
+static i32
+u32_count_trailing_zeros(u32 mask) {
+#if defined(GB_COMPILER_MSVC)
+	unsigned long result = 0;
+	_BitScanForward(&result, mask);
+	return (i32)result;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
 
-		if (parser->token->type != TokenType_Ascii || parser->token->ascii != ')') {
-			result->call.args = gb_alloc_item(parser->arena_allocator, AstArgument);
-			AstArgument *current_arg = result->call.args;
-			current_arg->val = parse_expr(parser);
-			current_arg->next = 0;
-			result->call.arg_count = 1;
+#endif
 
-			while (parser->token->type != TokenType_Ascii || parser->token->ascii != ')') {
-				current_arg->next = gb_alloc_item(parser->arena_allocator, AstArgument);
-				current_arg = current_arg->next;
-				current_arg->val = parse_expr(parser);
-				current_arg->next = 0;
-				result->call.arg_count += 1;
-			}
-		}
+#define LEXER_SCALAR_PREFIX 16
 
-		GB_ASSERT(parser->token->type == TokenType_Ascii);
-		GB_ASSERT(parser->token->ascii == ')');
-		parser_advance(parser);
+// NOTE(khvorov) Stops after LEXER_SCALAR_PREFIX bytes when limit_to_prefix is set
+static isize
+string_index_class_end(String *str, isize start, u8 class_mask, b32 limit_to_prefix) {
+	isize end = str->len;
+	if (limit_to_prefix && end > start + LEXER_SCALAR_PREFIX) {
+		end = start + LEXER_SCALAR_PREFIX;
 	}
+	isize result = start;
+	while (result < end && (LEXER_CHAR_CLASS[(u8)str->ptr[result]] & class_mask)) {
+		result += 1;
+	}
+	return result;
+}
 
+#if LEXER_SSE2
+// NOTE(khvorov) Macros rather than functions so that debug builds do not pay
+// for a call per 16 bytes. Bytes above 127 are negative and never in range.
+#define SSE2_IN_RANGE(chunk, lo, hi) _mm_and_si128( \
+	_mm_cmpgt_epi8((chunk), _mm_set1_epi8((lo) - 1)), _mm_cmplt_epi8((chunk), _mm_set1_epi8((hi) + 1)) \
+)
+
+#define SSE2_SPACE_MASK(chunk) (u32)_mm_movemask_epi8(_mm_or_si128( \
+	_mm_cmpeq_epi8((chunk), _mm_set1_epi8(' ')), SSE2_IN_RANGE((chunk), '\t', '\r') \
+))
+
+#define SSE2_ALPHANUM_MASK(chunk) (u32)_mm_movemask_epi8(_mm_or_si128( \
+	_mm_or_si128(SSE2_IN_RANGE((chunk), 'a', 'z'), SSE2_IN_RANGE((chunk), 'A', 'Z')), \
+	SSE2_IN_RANGE((chunk), '0', '9') \
+))
+
+#define SSE2_NEWLINE_MASK(chunk) (u32)_mm_movemask_epi8(_mm_or_si128( \
+	_mm_cmpeq_epi8((chunk), _mm_set1_epi8('\n')), _mm_cmpeq_epi8((chunk), _mm_set1_epi8('\r')) \
+))
+
+// NOTE(khvorov) Advances index until the first byte not set in mask_expr
+#define SSE2_SCAN_WHILE(str, index, mask_expr) do { \
+	while ((index) + 16 <= (str)->len) { \
+		__m128i chunk = _mm_loadu_si128((__m128i const *)((str)->ptr + (index))); \
+		u32 stop_mask = ~(mask_expr) & 0xFFFF; \
+		if (stop_mask != 0) { \
+			(index) += u32_count_trailing_zeros(stop_mask); \
+			break; \
+		} \
+		(index) += 16; \
+	} \
+} while (0)
+#endif
+
+// NOTE(khvorov) Tokens and whitespace runs are usually short so they are
+// scanned through the table first and only long runs go 16 bytes at a time
+static isize
+string_index_nonspace(String *str) {
+	isize result = string_index_class_end(str, 0, CharClass_Space, true);
+	if (result == LEXER_SCALAR_PREFIX) {
+#if LEXER_SSE2
+		SSE2_SCAN_WHILE(str, result, SSE2_SPACE_MASK(chunk));
+#endif
+		result = string_index_class_end(str, result, CharClass_Space, false);
+	}
 	return result;
 }
 
-static AstNode *
-parse_primary(AstParser *parser) {
+static isize
+string_index_nonident(String *str) {
+	isize result = string_index_class_end(str, 0, CharClass_Alphanum, true);
+	if (result == LEXER_SCALAR_PREFIX) {
+#if LEXER_SSE2
+		SSE2_SCAN_WHILE(str, result, SSE2_ALPHANUM_MASK(chunk));
+#endif
+		result = string_index_class_end(str, result, CharClass_Alphanum, false);
+	}
+	return result;
+}
 
-	AstNode *result = 0;
+// NOTE(khvorov) Returns the length of the string when there is no line break
+static isize
+string_index_newline(String *str) {
+	isize result = 0;
+#if LEXER_SSE2
+	SSE2_SCAN_WHILE(str, result, ~SSE2_NEWLINE_MASK(chunk));
+#endif
+	while (result < str->len && !(LEXER_CHAR_CLASS[(u8)str->ptr[result]] & CharClass_Newline)) {
+		result += 1;
+	}
+	return result;
+}
 
-	switch (parser->token->type) {
+static void
+string_offset_past_comment(String *str) {
+	isize to_skip = string_index_newline(str);
+	if (to_skip < str->len) {
+		char ch = str->ptr[to_skip];
+		to_skip += 1;
+		if (ch == '\r' && to_skip < str->len && str->ptr[to_skip] == '\n') {
+			to_skip += 1;
+		}
+	}
+	string_offset(str, to_skip, 0);
+}
 
-	case TokenType_Identifier: {
-		result = parse_iden(parser);
-	} break;
+typedef struct Keyword {
+	char *name;
+	TokenKind type;
+} Keyword;
+
+// NOTE(khvorov) Perfect hash over the keywords: (7 * first + second + len) % 16.
+// Slots are picked so that no two keywords collide, see keyword_table_check.
+gb_global Keyword const KEYWORD_TABLE[16] = {
+	[1] = { "extern", TokenType_Extern },
+	[3] = { "else", TokenType_Else },
+	[4] = { "def", TokenType_Def },
+	[6] = { "unary", TokenType_Unary },
+	[7] = { "if", TokenType_If },
+	[8] = { "then", TokenType_Then },
+	[12] = { "for", TokenType_For },
+	[13] = { "binary", TokenType_Binary },
+	[14] = { "var", TokenType_Var },
+	[15] = { "in", TokenType_In },
+};
+
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 6
 
-	case TokenType_Number: {
-		result = parse_number(parser);
-	} break;
+static isize
+keyword_hash(char *ptr, isize len) {
+	isize result = (7 * (u8)ptr[0] + (u8)ptr[1] + len) % gb_count_of(KEYWORD_TABLE);
+	return result;
+}
 
-	case TokenType_Ascii: {
-		if (parser->token->ascii == '(') {
-			result = parse_paren(parser);
+static TokenKind
+keyword_lookup(String *identifier) {
+	TokenKind result = TokenType_Identifier;
+	if (identifier->len >= KEYWORD_MIN_LEN && identifier->len <= KEYWORD_MAX_LEN) {
+		Keyword const *keyword = KEYWORD_TABLE + keyword_hash(identifier->ptr, identifier->len);
+		if (keyword->name != 0 && string_cmp_cstring(identifier, keyword->name)) {
+			result = keyword->type;
 		}
-	} break;
-
 	}
+	return result;
+}
 
-	GB_ASSERT(result != 0);
+static b32
+keyword_table_check(void) {
+	b32 result = true;
+	for (isize index = 0; index < gb_count_of(KEYWORD_TABLE); index += 1) {
+		Keyword const *keyword = KEYWORD_TABLE + index;
+		if (keyword->name != 0) {
+			isize len = gb_strlen(keyword->name);
+			result = result
+				&& keyword_hash(keyword->name, len) == index
+				&& len >= KEYWORD_MIN_LEN && len <= KEYWORD_MAX_LEN;
+		}
+	}
 	return result;
 }
 
-static AstNode *
-parse_binop_rhs(AstParser *parser, i32 precedence, AstNode *lhs) {
-	AstNode *result = lhs;
+static Token
+get_token_with_symbols(String *input, SymbolTable *symbols) {
+	Token result = { 0 };
 
-	while (true) {
-		i32 token_precendence = get_cur_tok_precedence(parser);
-		if (token_precendence < precedence) {
+	// NOTE(khvorov) Skip spaces and comments
+	while (input->len > 0) {
+		if (LEXER_CHAR_CLASS[(u8)input->ptr[0]] & CharClass_Space) {
+			string_offset(input, string_index_nonspace(input), 0);
+		} else if (input->ptr[0] == '#') {
+			string_offset_past_comment(input);
+		} else {
 			break;
 		}
+	}
 
-		char binop = parser->token->ascii;
-		parser_advance(parser);
+	if (input->len > 0) {
+		u8 first_class = LEXER_CHAR_CLASS[(u8)input->ptr[0]];
+		if (first_class & CharClass_Alpha) {
 
-		AstNode *rhs = parse_primary(parser);
+			isize identifier_end = string_index_nonident(input);
+			string_offset(input, identifier_end, &result.identifier);
 
-		i32 next_prec = get_cur_tok_precedence(parser);
-		if (token_precendence < next_prec) {
-			rhs = parse_binop_rhs(parser, token_precendence + 1, rhs);
-		}
+			result.type = keyword_lookup(&result.identifier);
+			if (result.type == TokenType_Identifier) {
+				result.symbol = symbol_intern(symbols, &result.identifier);
+			}
+
+		} else if (first_class & CharClass_Digit) {
+
+			isize number_end = string_index_class_end(input, 0, CharClass_Float, false);
+			string_offset(input, number_end, &result.identifier);
+			result.number = string_to_f64(result.identifier);
+
+			result.type = TokenType_Number;
 
-		AstNode *merged = gb_alloc_item(parser->arena_allocator, AstNode);
-		merged->type = AstType_Binary;
-		merged->binary.op = binop;
-		merged->binary.lhs = result;
-		merged->binary.rhs = rhs;
-		result = merged;
+		} else {
+			result.type = TokenType_Ascii;
+			result.ascii = input->ptr[0];
+			string_offset(input, 1, &result.identifier);
+		}
 	}
 
 	return result;
 }
 
-static AstPrototype *
-parse_prototype(AstParser *parser) {
-	GB_ASSERT(parser->token->type == TokenType_Identifier);
+static Token
+get_token(String *input) {
+	Token result = get_token_with_symbols(input, &global_symbols);
+	return result;
+}
 
-	String fn_name = parser->token->identifier;
-	parser_advance(parser);
+//
+// SECTION Source
+//
 
-	GB_ASSERT(parser->token->type == TokenType_Ascii && parser->token->ascii == '(');
-	parser_advance(parser);
+#define SOURCE_CHUNK_SIZE gb_kilobytes(64)
 
-	AstPrototype *proto = gb_alloc_item(parser->arena_allocator, AstPrototype);
-	proto->name = fn_name;
-	proto->param = 0;
-	proto->param_count = 0;
+static void
+source_reader_init(SourceReader *reader, gbFile *file, gbAllocator allocator) {
+	gb_zero_item(reader);
+	reader->file = file;
+	reader->allocator = allocator;
+	reader->buffer_cap = SOURCE_CHUNK_SIZE;
+	// NOTE(khvorov) One extra byte for the null terminator
+	reader->buffer = gb_alloc(allocator, reader->buffer_cap + 1);
+}
 
-	while (parser->token->type != TokenType_Ascii || parser->token->ascii != ')') {
-		GB_ASSERT(parser->token->type == TokenType_Identifier);
-		AstParameter *param = gb_alloc_item(parser->arena_allocator, AstParameter);
-		param->name = parser->token->identifier;
-		proto->param_count += 1;
-		parser_advance(parser);
+static void
+source_reader_destroy(SourceReader *reader) {
+	gb_free(reader->allocator, reader->buffer);
+}
 
-		if (proto->param == 0) {
-			proto->param = param;
-		}
+static isize
+source_read(SourceReader *reader, void *buffer, isize size) {
+	isize bytes_read = 0;
+#if defined(GB_SYSTEM_WINDOWS)
+	DWORD win32_bytes_read = 0;
+	if (ReadFile(reader->file->fd.p, buffer, (DWORD)size, &win32_bytes_read, 0)) {
+		bytes_read = win32_bytes_read;
+	}
+#else
+	// NOTE(khvorov) Not gb_file_read_at because pread does not work on pipes
+	isize read_result = read(reader->file->fd.i, buffer, size);
+	if (read_result > 0) {
+		bytes_read = read_result;
 	}
+#endif
+	return bytes_read;
+}
 
-	GB_ASSERT(parser->token->type == TokenType_Ascii && parser->token->ascii == ')');
-	parser_advance(parser);
+// NOTE(khvorov) Tokens never span lines so the lexer can always be handed
+// whole lines. Returns false once the input is exhausted.
+static b32
+source_reader_next_lines(SourceReader *reader, String *lines) {
+	isize tail_len = reader->buffer_len - reader->lines_len;
+	gb_memmove(reader->buffer, reader->buffer + reader->lines_len, tail_len);
+	reader->buffer_len = tail_len;
+	reader->lines_len = 0;
+
+	while (reader->lines_len == 0 && !reader->eof) {
+		if (reader->buffer_len == reader->buffer_cap) {
+			isize new_cap = reader->buffer_cap * 2;
+			reader->buffer = gb_resize(reader->allocator, reader->buffer, reader->buffer_cap + 1, new_cap + 1);
+			reader->buffer_cap = new_cap;
+		}
 
-	return proto;
-}
+		isize search_start = reader->buffer_len;
+		isize bytes_read = source_read(reader, reader->buffer + reader->buffer_len, reader->buffer_cap - reader->buffer_len);
+		reader->buffer_len += bytes_read;
 
-static AstFunction *
-parse_definition(AstParser *parser) {
-	GB_ASSERT(parser->token->type == TokenType_Def);
-	parser_advance(parser);
+		if (bytes_read == 0) {
+			reader->eof = true;
+			reader->lines_len = reader->buffer_len;
+		} else {
+			for (isize index = reader->buffer_len - 1; index >= search_start; index -= 1) {
+				if (reader->buffer[index] == '\n') {
+					reader->lines_len = index + 1;
+					break;
+				}
+			}
+		}
+	}
 
-	AstFunction *result = gb_alloc_item(parser->arena_allocator, AstFunction);
-	result->proto = parse_prototype(parser);
-	result->body = parse_expr(parser);
+	if (reader->eof) {
+		reader->buffer[reader->lines_len] = '\0';
+	}
+	lines->ptr = reader->buffer;
+	lines->len = reader->lines_len;
 
+	b32 result = lines->len > 0;
 	return result;
 }
 
-static AstPrototype *
-parse_extern(AstParser *parser) {
-	GB_ASSERT(parser->token->type == TokenType_Extern);
-	parser_advance(parser);
+// NOTE(khvorov) The file is lexed straight out of the page cache. The mapping
+// has to outlive the file's lexer and token stream.
+static b32
+source_map_file(SourceMapping *mapping, char const *path) {
+	gb_zero_item(mapping);
 
-	AstPrototype *proto = parse_prototype(parser);
-	return proto;
+	gbFile file = { 0 };
+	if (gb_file_open(&file, path) != gbFileError_None) {
+		return false;
+	}
+
+	b32 result = true;
+	mapping->size = (isize)gb_file_size(&file);
+	if (mapping->size > 0) {
+#if defined(GB_SYSTEM_WINDOWS)
+		mapping->win32_mapping = CreateFileMappingW(file.fd.p, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping->win32_mapping != 0) {
+			mapping->data = MapViewOfFile(mapping->win32_mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+		result = mapping->data != 0;
+#else
+		mapping->data = mmap(0, mapping->size, PROT_READ, MAP_PRIVATE, file.fd.i, 0);
+		if (mapping->data == MAP_FAILED) {
+			mapping->data = 0;
+			result = false;
+		} else {
+			madvise(mapping->data, mapping->size, MADV_SEQUENTIAL);
+		}
+#endif
+	}
+
+	gb_file_close(&file);
+	return result;
 }
 
-static AstFunction *
-parse_top_level_expr(AstParser *parser) {
-	AstFunction *fun = gb_alloc_item(parser->arena_allocator, AstFunction);
-	fun->proto = gb_alloc_item(parser->arena_allocator, AstPrototype);
-	gb_zero_item(fun->proto);
-	fun->body = parse_expr(parser);
-	return fun;
+static void
+source_unmap_file(SourceMapping *mapping) {
+	if (mapping->data != 0) {
+#if defined(GB_SYSTEM_WINDOWS)
+		UnmapViewOfFile(mapping->data);
+		CloseHandle(mapping->win32_mapping);
+#else
+		munmap(mapping->data, mapping->size);
+#endif
+	}
+	gb_zero_item(mapping);
+}
+
+static void
+lexer_init(Lexer *lexer, gbFile *file, gbAllocator allocator) {
+	source_reader_init(&lexer->reader, file, allocator);
+	lexer->input.ptr = 0;
+	lexer->input.len = 0;
+}
+
+static void
+lexer_init_mapped(Lexer *lexer, SourceMapping *mapping) {
+	gb_zero_item(&lexer->reader);
+	lexer->input.ptr = mapping->data;
+	lexer->input.len = mapping->size;
+}
+
+static void
+lexer_destroy(Lexer *lexer) {
+	if (lexer->reader.file != 0) {
+		source_reader_destroy(&lexer->reader);
+	}
 }
 
 //
-// SECTION LLVM
+// SECTION Token Stream
 //
 
-static LLVMValueRef lb_node(LLVMBackend *lb, AstNode *node);
+static void
+token_stream_init(TokenStream *stream, String source, gbAllocator allocator) {
+	GB_ASSERT_MSG(source.len <= U32_MAX, "token offsets are 32-bit");
+	stream->source = source;
+	gb_array_init_u8(&stream->kinds, allocator);
+	gb_array_init_u32(&stream->offsets, allocator);
+	gb_array_init_Symbol(&stream->symbols, allocator);
+	gb_array_init_f64(&stream->numbers, allocator);
+}
 
-static LLVMValueRef
-lb_number(LLVMBackend *lb, AstNumber *number) {
-	f64 val = number->val;
-	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
-	LLVMValueRef llvm_val = LLVMConstReal(type_double, val);
-	return llvm_val;
+static void
+token_stream_destroy(TokenStream *stream) {
+	gb_array_free_u8(&stream->kinds);
+	gb_array_free_u32(&stream->offsets);
+	gb_array_free_Symbol(&stream->symbols);
+	gb_array_free_f64(&stream->numbers);
 }
 
-static LLVMValueRef
-lb_variable(LLVMBackend *lb, AstVariable *variable) {
-	LLVMValueRef *find_result = gb_htab_get(&lb->named_values, &variable->name);
-	GB_ASSERT_NOT_NULL(find_result);
-	LLVMValueRef result = *find_result;
+static void
+token_stream_append(TokenStream *stream, Token *token) {
+	gb_array_append_u8(&stream->kinds, (u8)token->type);
+	gb_array_append_u32(&stream->offsets, (u32)(token->identifier.ptr - stream->source.ptr));
+	if (token->type == TokenType_Identifier) {
+		gb_array_append_Symbol(&stream->symbols, token->symbol);
+	} else if (token->type == TokenType_Number) {
+		gb_array_append_f64(&stream->numbers, token->number);
+	}
+}
+
+static void
+token_stream_lex(TokenStream *stream) {
+	String input = stream->source;
+	while (true) {
+		Token token = get_token(&input);
+		if (token.type == TokenType_EOF) {
+			break;
+		}
+		token_stream_append(stream, &token);
+	}
+}
+
+static isize
+token_stream_size(TokenStream *stream) {
+	isize result = stream->kinds.cap * gb_size_of(u8)
+		+ stream->offsets.cap * gb_size_of(u32)
+		+ stream->symbols.cap * gb_size_of(Symbol)
+		+ stream->numbers.cap * gb_size_of(f64);
 	return result;
 }
 
-static LLVMValueRef
-lb_binary(LLVMBackend *lb, AstBinary *binary) {
-	LLVMValueRef lhs = lb_node(lb, binary->lhs);
-	LLVMValueRef rhs = lb_node(lb, binary->rhs);
+// NOTE(khvorov) The length of the token text is not kept
+static Token
+parser_stream_next_token(AstParser *parser) {
+	TokenStream *stream = parser->stream;
+	Token result = { 0 };
+	if (parser->stream_token_index < stream->kinds.len) {
+		u8 kind = stream->kinds.ptr[parser->stream_token_index];
+		u32 offset = stream->offsets.ptr[parser->stream_token_index];
+		parser->stream_token_index += 1;
+
+		result.type = (TokenKind)kind;
+		result.identifier.ptr = stream->source.ptr + offset;
+		switch (result.type) {
+		case TokenType_Identifier: {
+			result.symbol = stream->symbols.ptr[parser->stream_symbol_index];
+			parser->stream_symbol_index += 1;
+		} break;
+
+		case TokenType_Number: {
+			result.number = stream->numbers.ptr[parser->stream_number_index];
+			parser->stream_number_index += 1;
+		} break;
+
+		case TokenType_Ascii: {
+			result.ascii = stream->source.ptr[offset];
+		} break;
+		}
+	}
+	return result;
+}
 
-	LLVMValueRef result = 0;
+// NOTE(khvorov) Only called once the ring is empty. Lexes ahead until the ring
+// is full but never reads new lines to do so, which would block on stdin.
+static void
+parser_fill_tokens(AstParser *parser) {
+	Lexer *lexer = parser->lexer;
+	GB_ASSERT(parser->ring_count == 0);
+
+	if (parser->stream != 0) {
+		while (parser->ring_count < PARSER_TOKEN_RING_SIZE) {
+			Token token = parser_stream_next_token(parser);
+			if (token.type == TokenType_EOF) {
+				break;
+			}
+			isize ring_index = (parser->ring_head + parser->ring_count) & (PARSER_TOKEN_RING_SIZE - 1);
+			parser->token_ring[ring_index] = token;
+			parser->ring_count += 1;
+		}
+	}
 
-	switch (binary->op) {
+	while (lexer != 0 && parser->ring_count == 0) {
+		if (lexer->input.len == 0) {
+			if (lexer->reader.file == 0 || !source_reader_next_lines(&lexer->reader, &lexer->input)) {
+				break;
+			}
+		}
+		while (parser->ring_count < PARSER_TOKEN_RING_SIZE) {
+			Token token = get_token(&lexer->input);
+			if (token.type == TokenType_EOF) {
+				break;
+			}
+			isize ring_index = (parser->ring_head + parser->ring_count) & (PARSER_TOKEN_RING_SIZE - 1);
+			parser->token_ring[ring_index] = token;
+			parser->ring_count += 1;
+		}
+	}
 
-	case '+': {
-		result = LLVMBuildFAdd(lb->builder, lhs, rhs, "addtmp");
-	} break;
+	if (parser->ring_count == 0) {
+		gb_zero_item(&parser->token_ring[parser->ring_head]);
+	}
+	parser->token = &parser->token_ring[parser->ring_head];
+}
 
-	case '-': {
-		result = LLVMBuildFSub(lb->builder, lhs, rhs, "subtmp");
-	} break;
+static void
+parser_set_lexer(AstParser *parser, Lexer *lexer) {
+	parser->lexer = lexer;
+	parser->stream = 0;
+	parser->ring_head = 0;
+	parser->ring_count = 0;
+	parser_fill_tokens(parser);
+}
 
-	case '*': {
-		result = LLVMBuildFMul(lb->builder, lhs, rhs, "multmp");
-	} break;
+static void
+parser_set_stream(AstParser *parser, TokenStream *stream) {
+	parser->lexer = 0;
+	parser->stream = stream;
+	parser->stream_token_index = 0;
+	parser->stream_symbol_index = 0;
+	parser->stream_number_index = 0;
+	parser->ring_head = 0;
+	parser->ring_count = 0;
+	parser_fill_tokens(parser);
+}
 
-	case '<': {
-		LLVMValueRef logical = LLVMBuildFCmp(lb->builder, LLVMRealULT, lhs, rhs, "cmptmp");
-		LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
-		result = LLVMBuildUIToFP(lb->builder, logical, type_double, "booltemp");
-	} break;
+//
+// SECTION AST
+//
 
-	default: {
-		GB_PANIC("unexpected binary op");
-	}
-	}
+static void
+ast_pool_init(AstPool *pool, gbAllocator allocator) {
+	gb_array_init(&pool->numbers, allocator, sizeof(AstNumber));
+	gb_array_init(&pool->variables, allocator, sizeof(AstVariable));
+	gb_array_init(&pool->unaries, allocator, sizeof(AstUnary));
+	gb_array_init(&pool->binaries, allocator, sizeof(AstBinary));
+	gb_array_init(&pool->calls, allocator, sizeof(AstCall));
+	gb_array_init(&pool->args, allocator, sizeof(AstExpr));
+	gb_array_init(&pool->ifs, allocator, sizeof(AstIf));
+	gb_array_init(&pool->fors, allocator, sizeof(AstFor));
+	gb_array_init(&pool->vars, allocator, sizeof(AstVar));
+	gb_array_init(&pool->var_bindings, allocator, sizeof(AstVarBinding));
+}
 
+static void
+ast_pool_destroy(AstPool *pool) {
+	gb_array_free(&pool->numbers);
+	gb_array_free(&pool->variables);
+	gb_array_free(&pool->unaries);
+	gb_array_free(&pool->binaries);
+	gb_array_free(&pool->calls);
+	gb_array_free(&pool->args);
+	gb_array_free(&pool->ifs);
+	gb_array_free(&pool->fors);
+	gb_array_free(&pool->vars);
+	gb_array_free(&pool->var_bindings);
+}
+
+static isize
+ast_pool_node_count(AstPool *pool) {
+	isize result = pool->numbers.len + pool->variables.len + pool->unaries.len
+		+ pool->binaries.len + pool->calls.len + pool->ifs.len + pool->fors.len
+		+ pool->vars.len;
 	return result;
 }
 
-static LLVMValueRef
-lb_call(LLVMBackend *lb, AstCall *call) {
-	gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&lb->arena);
+static AstPoolMark
+ast_pool_mark(AstPool *pool) {
+	AstPoolMark result;
+	result.numbers = pool->numbers.len;
+	result.variables = pool->variables.len;
+	result.unaries = pool->unaries.len;
+	result.binaries = pool->binaries.len;
+	result.calls = pool->calls.len;
+	result.args = pool->args.len;
+	result.ifs = pool->ifs.len;
+	result.fors = pool->fors.len;
+	result.vars = pool->vars.len;
+	result.var_bindings = pool->var_bindings.len;
+	return result;
+}
 
-	char* temp_callee_name = string_to_cstring(&call->callee, lb->arena_allocator);
-	LLVMValueRef callee = LLVMGetNamedFunction(lb->module, temp_callee_name);
-	GB_ASSERT(callee != 0);
-	GB_ASSERT(LLVMCountParams(callee) == call->arg_count);
+// NOTE(khvorov) Drops every node added since the mark was taken
+static void
+ast_pool_reset(AstPool *pool, AstPoolMark mark) {
+	gb_array_resize(&pool->numbers, mark.numbers);
+	gb_array_resize(&pool->variables, mark.variables);
+	gb_array_resize(&pool->unaries, mark.unaries);
+	gb_array_resize(&pool->binaries, mark.binaries);
+	gb_array_resize(&pool->calls, mark.calls);
+	gb_array_resize(&pool->args, mark.args);
+	gb_array_resize(&pool->ifs, mark.ifs);
+	gb_array_resize(&pool->fors, mark.fors);
+	gb_array_resize(&pool->vars, mark.vars);
+	gb_array_resize(&pool->var_bindings, mark.var_bindings);
+}
 
-	LLVMValueRef *arg_vals = gb_alloc_array(lb->arena_allocator, LLVMValueRef, call->arg_count);
-	isize arg_index = 0;
-	for (AstArgument *arg = call->args; arg != 0; arg = arg->next) {
-		arg_vals[arg_index] = lb_node(lb, arg->val);
-		arg_index += 1;
-	}
+static AstExpr
+ast_add(gbDynamicArray *nodes, AstType type, void *node) {
+	GB_ASSERT(nodes->len < (1 << (32 - AST_TYPE_BITS)));
+	AstExpr result = ((u32)nodes->len << AST_TYPE_BITS) | (u32)type;
+	gb_array_append(nodes, node);
+	return result;
+}
 
-	LLVMValueRef result = LLVMBuildCall(lb->builder, callee, arg_vals, (unsigned int)call->arg_count, "calltmp");
+static AstType
+ast_type(AstExpr expr) {
+	AstType result = (AstType)(expr & ((1 << AST_TYPE_BITS) - 1));
+	return result;
+}
 
-	gb_temp_arena_memory_end(temp_memory);
+static void *
+ast_get(gbDynamicArray *nodes, AstExpr expr) {
+	isize index = expr >> AST_TYPE_BITS;
+	GB_ASSERT(index < nodes->len);
+	void *result = gb_array_get(nodes, index);
 	return result;
 }
 
-static LLVMValueRef
-lb_proto(LLVMBackend *lb, AstPrototype *proto) {
-	gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&lb->arena);
+//
+// SECTION Parser
+//
 
-	LLVMTypeRef *arg_types = gb_alloc_array(lb->arena_allocator, LLVMTypeRef, proto->param_count);
-	LLVMTypeRef llvm_double = LLVMDoubleTypeInContext(lb->ctx);
-	for (isize arg_type_index = 0; arg_type_index < proto->param_count; arg_type_index += 1) {
-		arg_types[arg_type_index] = llvm_double;
+// NOTE(khvorov) Built-in operators, user-defined ones are added to the
+// parser's copy of this table as their definitions are parsed
+static u8 const BINARY_PRECEDENCE[256] = {
+	['='] = 2,
+	['<'] = 10,
+	['+'] = 20,
+	['-'] = 20,
+	['*'] = 40,
+};
+
+// NOTE(khvorov) The parser arena chains on more blocks of this size as needed
+#ifndef PARSER_ARENA_BLOCK_SIZE
+#define PARSER_ARENA_BLOCK_SIZE gb_kilobytes(64)
+#endif
+
+static void
+parser_init(AstParser *parser, gbAllocator allocator) {
+	gb_zero_item(parser);
+	gb_arena_init_from_allocator(&parser->arena, allocator, PARSER_ARENA_BLOCK_SIZE);
+	parser->arena_allocator = gb_arena_allocator(&parser->arena);
+	ast_pool_init(&parser->ast, allocator);
+	gb_array_init(&parser->frames, allocator, sizeof(ParseFrame));
+	gb_array_init(&parser->operands, allocator, sizeof(AstExpr));
+	gb_array_init(&parser->bindings, allocator, sizeof(AstVarBinding));
+	gb_memcopy(parser->binary_precedence, BINARY_PRECEDENCE, gb_size_of(parser->binary_precedence));
+}
+
+static void
+parser_destroy(AstParser *parser) {
+	gb_arena_free(&parser->arena);
+	ast_pool_destroy(&parser->ast);
+	gb_array_free(&parser->frames);
+	gb_array_free(&parser->operands);
+	gb_array_free(&parser->bindings);
+}
+
+
+static i32
+get_cur_tok_precedence(AstParser *parser) {
+	i32 result = -1;
+
+	if (parser->token->type == TokenType_Ascii) {
+		u8 precedence = parser->binary_precedence[(u8)parser->token->ascii];
+		if (precedence != 0) {
+			result = precedence;
+		}
 	}
 
-	LLVMTypeRef fun_type = LLVMFunctionType(llvm_double, arg_types, (unsigned int)proto->param_count, false);
+	return result;
+}
 
-	char *temp_fun_name = string_to_cstring(&proto->name, lb->arena_allocator);
-	LLVMValueRef llvm_fun = LLVMAddFunction(lb->module, temp_fun_name, fun_type);
 
-	for (isize arg_index = 0; arg_index < proto->param_count; arg_index += 1) {
-		LLVMValueRef llvm_param = LLVMGetParam(llvm_fun, (unsigned int)arg_index);
-		String param_name = proto->param[arg_index].name;
-		LLVMSetValueName2(llvm_param, param_name.ptr, param_name.len);
+static void
+parser_advance(AstParser *parser) {
+	GB_ASSERT(parser->token->type != TokenType_EOF);
+	parser->ring_head = (parser->ring_head + 1) & (PARSER_TOKEN_RING_SIZE - 1);
+	parser->ring_count -= 1;
+	if (parser->ring_count == 0) {
+		parser_fill_tokens(parser);
+	} else {
+		parser->token = &parser->token_ring[parser->ring_head];
 	}
+}
 
-	gb_temp_arena_memory_end(temp_memory);
-	return llvm_fun;
+static Symbol
+parser_identifier(AstParser *parser) {
+	GB_ASSERT(parser->token->type == TokenType_Identifier);
+	Symbol result = parser->token->symbol;
+	return result;
 }
 
-static LLVMValueRef
-lb_function(LLVMBackend *lb, AstFunction *fun) {
-	gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&lb->arena);
+static b32
+parser_token_is_ascii(AstParser *parser, char ascii) {
+	b32 result = parser->token->type == TokenType_Ascii && parser->token->ascii == ascii;
+	return result;
+}
 
-	char* temp_fun_name = string_to_cstring(&fun->proto->name, lb->arena_allocator);
-	LLVMValueRef llvm_existing_fun = LLVMGetNamedFunction(lb->module, temp_fun_name);
-	GB_ASSERT(llvm_existing_fun == 0);
+// NOTE(khvorov) Characters the grammar itself uses, never an operator
+static b32
+ascii_is_syntax(char ascii) {
+	b32 result = ascii == '(' || ascii == ')' || ascii == ',' || ascii == ';' || ascii == '=';
+	return result;
+}
 
-	LLVMValueRef llvm_proto = lb_proto(lb, fun->proto);
+// NOTE(khvorov) lb_binary emits these directly and never calls a definition
+static b32
+ascii_is_builtin_binary(char ascii) {
+	b32 result = ascii == '+' || ascii == '-' || ascii == '*' || ascii == '<' || ascii == '=';
+	return result;
+}
 
-	LLVMBasicBlockRef entry_block = LLVMAppendBasicBlockInContext(lb->ctx, llvm_proto, "entry");
-	LLVMPositionBuilderAtEnd(lb->builder, entry_block);
+static AstExpr
+parse_number(AstParser *parser) {
+	Token *token = parser->token;
+	GB_ASSERT(token->type == TokenType_Number);
+	AstNumber number = { token->number };
+	AstExpr result = ast_add(&parser->ast.numbers, AstType_Number, &number);
+	parser_advance(parser);
+	return result;
+}
 
-	gb_htab_clear(&lb->named_values);
-	for (isize arg_index = 0; arg_index < fun->proto->param_count; arg_index += 1) {
-		LLVMValueRef llvm_param = LLVMGetParam(llvm_proto, (unsigned int)arg_index);
-		String param_name = fun->proto->param[arg_index].name;
-		gb_htab_set(&lb->named_values, &param_name, &llvm_param);
+static ParseFrame *
+parser_top_frame(AstParser *parser, isize frames_base) {
+	ParseFrame *result = 0;
+	if (parser->frames.len > frames_base) {
+		result = gb_array_get(&parser->frames, parser->frames.len - 1);
 	}
+	return result;
+}
 
-	LLVMValueRef llvm_body_return = lb_node(lb, fun->body);
-	LLVMBuildRet(lb->builder, llvm_body_return);
+static AstExpr
+parser_pop_operand(AstParser *parser) {
+	GB_ASSERT(parser->operands.len > 0);
+	AstExpr result = *(AstExpr *)gb_array_get(&parser->operands, parser->operands.len - 1);
+	gb_array_pop(&parser->operands);
+	return result;
+}
 
-	LLVMVerifyFunction(llvm_proto, LLVMAbortProcessAction);
+static void
+parser_reduce_binary(AstParser *parser) {
+	ParseFrame *frame = gb_array_get(&parser->frames, parser->frames.len - 1);
+	GB_ASSERT(frame->type == ParseFrame_Binary);
+	AstBinary binary = { 0 };
+	binary.op = frame->op;
+	if (!ascii_is_builtin_binary(binary.op)) {
+		Symbol *function = parser->binary_functions + (u8)binary.op;
+		if (*function == 0) {
+			*function = symbol_intern_operator(&global_symbols, "binary", binary.op);
+		}
+		binary.function = *function;
+	}
+	binary.rhs = parser_pop_operand(parser);
+	binary.lhs = parser_pop_operand(parser);
+	gb_array_pop(&parser->frames);
+	AstExpr result = ast_add(&parser->ast.binaries, AstType_Binary, &binary);
+	gb_array_append(&parser->operands, &result);
+}
 
-	gb_temp_arena_memory_end(temp_memory);
-	return llvm_proto;
+// NOTE(khvorov) Unary operators bind tighter than any binary operator, so they
+// apply as soon as their operand is complete
+static void
+parser_push_operand(AstParser *parser, AstExpr operand, isize frames_base) {
+	ParseFrame *top = parser_top_frame(parser, frames_base);
+	while (top != 0 && top->type == ParseFrame_Unary) {
+		Symbol *function = parser->unary_functions + (u8)top->op;
+		if (*function == 0) {
+			*function = symbol_intern_operator(&global_symbols, "unary", top->op);
+		}
+		AstUnary unary = { top->op, *function, operand };
+		operand = ast_add(&parser->ast.unaries, AstType_Unary, &unary);
+		gb_array_pop(&parser->frames);
+		top = parser_top_frame(parser, frames_base);
+	}
+	gb_array_append(&parser->operands, &operand);
 }
 
-static LLVMValueRef
-lb_node(LLVMBackend *lb, AstNode *node) {
-	LLVMValueRef result = 0;
+// NOTE(khvorov) The arguments are the operands pushed since the call started
+static void
+parser_reduce_call(AstParser *parser, isize frames_base) {
+	ParseFrame *frame = gb_array_get(&parser->frames, parser->frames.len - 1);
+	GB_ASSERT(frame->type == ParseFrame_Call);
+	AstCall call = { 0 };
+	call.callee = frame->name;
+	call.arg_start = (u32)parser->ast.args.len;
+	call.arg_count = (u32)(parser->operands.len - frame->operand_start);
+	gb_array_appendv(&parser->ast.args, gb_array_get(&parser->operands, frame->operand_start), call.arg_count);
+	gb_array_resize(&parser->operands, frame->operand_start);
+	gb_array_pop(&parser->frames);
+	AstExpr result = ast_add(&parser->ast.calls, AstType_Call, &call);
+	parser_push_operand(parser, result, frames_base);
+}
 
-	switch (node->type) {
-	case AstType_None: { GB_PANIC("unexpected AstType_None"); } break;
-	case AstType_Number: { result = lb_number(lb, &node->number); } break;
-	case AstType_Variable: { result = lb_variable(lb, &node->variable); } break;
-	case AstType_Binary: { result = lb_binary(lb, &node->binary); } break;
-	case AstType_Call: { result = lb_call(lb, &node->call); } break;
-	}
+static void
+parser_expect_keyword(AstParser *parser, TokenKind type, char *keyword) {
+	GB_ASSERT_MSG(parser->token->type == type, "expected '%s'", keyword);
+	parser_advance(parser);
+}
 
+// NOTE(khvorov) After a var binding. Returns true if another binding follows.
+static b32
+parser_var_separator(AstParser *parser, ParseFrame *frame) {
+	b32 result = false;
+	if (parser_token_is_ascii(parser, ',')) {
+		parser_advance(parser);
+		result = true;
+	} else {
+		parser_expect_keyword(parser, TokenType_In, "in");
+		frame->stage = ParseStage_VarBody;
+	}
 	return result;
 }
 
-//
-// SECTION Main
-//
+// NOTE(khvorov) Reads var bindings up to the next initializer or the body
+static void
+parser_var_bindings(AstParser *parser, ParseFrame *frame) {
+	b32 more = true;
+	while (more) {
+		AstVarBinding binding = { parser_identifier(parser), 0 };
+		gb_array_append(&parser->bindings, &binding);
+		parser_advance(parser);
+		if (parser_token_is_ascii(parser, '=')) {
+			parser_advance(parser);
+			frame->stage = ParseStage_VarInit;
+			more = false;
+		} else {
+			more = parser_var_separator(parser, frame);
+		}
+	}
+}
 
-int
-main() {
+// NOTE(khvorov) One part of an if, a for or a var has been parsed. Moves on to
+// the next part and returns true, or builds the node once the last part is done.
+static b32
+parser_next_stage(AstParser *parser, isize frames_base) {
+	ParseFrame *frame = gb_array_get(&parser->frames, parser->frames.len - 1);
+	b32 result = true;
 
-	String input = string_from_cstring("def foo(x y z) foo(1 2 3)");
+	switch (frame->stage) {
+	case ParseStage_Cond: {
+		parser_expect_keyword(parser, TokenType_Then, "then");
+		frame->stage = ParseStage_Then;
+	} break;
 
-	gbAllocator heap_allocator = gb_heap_allocator();
+	case ParseStage_Then: {
+		parser_expect_keyword(parser, TokenType_Else, "else");
+		frame->stage = ParseStage_Else;
+	} break;
 
-	gbDynamicArray tokens = { 0 };
-	gb_array_init(&tokens, heap_allocator, sizeof(Token));
-	while (true) {
-		Token token = get_token(&input);
-		if (token.type == TokenType_EOF) {
-			break;
-		}
-		gb_array_append(&tokens, &token);
-	}
+	case ParseStage_Else: {
+		AstIf node = { 0 };
+		node.else_branch = parser_pop_operand(parser);
+		node.then_branch = parser_pop_operand(parser);
+		node.cond = parser_pop_operand(parser);
+		gb_array_pop(&parser->frames);
+		parser_push_operand(parser, ast_add(&parser->ast.ifs, AstType_If, &node), frames_base);
+		result = false;
+	} break;
 
-	AstParser parser = { 0 };
-	gb_arena_init_from_allocator(&parser.arena, heap_allocator, gb_megabytes(4));
-	parser.arena_allocator = gb_arena_allocator(&parser.arena);
-	parser.token = tokens.ptr;
-	parser.token_count = tokens.len;
-
-	AstFunction *top_level_node = 0;
-	switch (parser.token->type) {
-	case TokenType_EOF: {
-		GB_ASSERT(!"unexpected eof");
+	case ParseStage_Start: {
+		GB_ASSERT_MSG(parser_token_is_ascii(parser, ','), "expected ',' after the loop start");
+		parser_advance(parser);
+		frame->stage = ParseStage_End;
 	} break;
 
-	case TokenType_Ascii: {
-		if (parser.token->ascii == ';') {
-			parser_advance(&parser);
+	case ParseStage_End: {
+		if (parser_token_is_ascii(parser, ',')) {
+			parser_advance(parser);
+			frame->has_step = true;
+			frame->stage = ParseStage_Step;
+		} else {
+			parser_expect_keyword(parser, TokenType_In, "in");
+			frame->stage = ParseStage_Body;
 		}
 	} break;
 
-	case TokenType_Def: {
-		top_level_node = parse_definition(&parser);
+	case ParseStage_Step: {
+		parser_expect_keyword(parser, TokenType_In, "in");
+		frame->stage = ParseStage_Body;
+	} break;
+
+	case ParseStage_Body: {
+		AstFor node = { 0 };
+		node.var = frame->name;
+		node.body = parser_pop_operand(parser);
+		if (frame->has_step) {
+			node.step = parser_pop_operand(parser);
+		}
+		node.end = parser_pop_operand(parser);
+		node.start = parser_pop_operand(parser);
+		gb_array_pop(&parser->frames);
+		parser_push_operand(parser, ast_add(&parser->ast.fors, AstType_For, &node), frames_base);
+		result = false;
 	} break;
 
-	case TokenType_Extern: {
-		GB_ASSERT("unimplemented");
-		//top_level_node = parse_extern(&parser);
+	case ParseStage_VarInit: {
+		// NOTE(khvorov) Vars nested in the initializer have taken their bindings
+		// off the stack by now
+		AstVarBinding *binding = gb_array_get(&parser->bindings, parser->bindings.len - 1);
+		binding->init = parser_pop_operand(parser);
+		if (parser_var_separator(parser, frame)) {
+			parser_var_bindings(parser, frame);
+		}
 	} break;
 
-	default: {
-		top_level_node = parse_top_level_expr(&parser);
+	case ParseStage_VarBody: {
+		AstVar node = { 0 };
+		node.binding_start = (u32)parser->ast.var_bindings.len;
+		node.binding_count = (u32)(parser->bindings.len - frame->operand_start);
+		node.body = parser_pop_operand(parser);
+		gb_array_appendv(&parser->ast.var_bindings, gb_array_get(&parser->bindings, frame->operand_start), node.binding_count);
+		gb_array_resize(&parser->bindings, frame->operand_start);
+		gb_array_pop(&parser->frames);
+		parser_push_operand(parser, ast_add(&parser->ast.vars, AstType_Var, &node), frames_base);
+		result = false;
 	} break;
 	}
-	GB_ASSERT_NOT_NULL(top_level_node);
 
-	LLVMBackend llvm_backend;
-	llvm_backend.ctx = LLVMGetGlobalContext();
-	llvm_backend.builder = LLVMCreateBuilderInContext(llvm_backend.ctx);
-	llvm_backend.module = LLVMModuleCreateWithNameInContext("KaleidoscopeModule", llvm_backend.ctx);
+	return result;
+}
 
-	gb_htab_init(
-		&llvm_backend.named_values, heap_allocator, sizeof(String), sizeof(LLVMValueRef),
-		string_hash, string_cmp
-	);
+// NOTE(khvorov) Shunting-yard. Parentheses, calls, ifs, loops and operators
+// waiting for their right-hand side live on the parser's frame stack rather
+// than the C stack, so nesting depth is only limited by memory.
+static AstExpr
+parse_expr(AstParser *parser) {
+	isize frames_base = parser->frames.len;
+	isize operands_base = parser->operands.len;
+	b32 expect_operand = true;
+	b32 done = false;
+
+	while (!done) {
+		if (expect_operand) {
+			expect_operand = false;
+			switch (parser->token->type) {
+
+			case TokenType_Number: {
+				AstExpr number = parse_number(parser);
+				parser_push_operand(parser, number, frames_base);
+			} break;
+
+			case TokenType_Identifier: {
+				Symbol name = parser_identifier(parser);
+				parser_advance(parser);
+				if (parser_token_is_ascii(parser, '(')) {
+					parser_advance(parser);
+					ParseFrame frame = { 0 };
+					frame.type = ParseFrame_Call;
+					frame.name = name;
+					frame.operand_start = (u32)parser->operands.len;
+					gb_array_append(&parser->frames, &frame);
+					if (parser_token_is_ascii(parser, ')')) {
+						parser_advance(parser);
+						parser_reduce_call(parser, frames_base);
+					} else {
+						expect_operand = true;
+					}
+				} else {
+					AstVariable variable = { name };
+					AstExpr result = ast_add(&parser->ast.variables, AstType_Variable, &variable);
+					parser_push_operand(parser, result, frames_base);
+				}
+			} break;
+
+			case TokenType_If: {
+				parser_advance(parser);
+				ParseFrame frame = { 0 };
+				frame.type = ParseFrame_If;
+				frame.stage = ParseStage_Cond;
+				gb_array_append(&parser->frames, &frame);
+				expect_operand = true;
+			} break;
+
+			case TokenType_For: {
+				parser_advance(parser);
+				ParseFrame frame = { 0 };
+				frame.type = ParseFrame_For;
+				frame.stage = ParseStage_Start;
+				frame.name = parser_identifier(parser);
+				parser_advance(parser);
+				GB_ASSERT_MSG(parser_token_is_ascii(parser, '='), "expected '=' after the loop variable");
+				parser_advance(parser);
+				gb_array_append(&parser->frames, &frame);
+				expect_operand = true;
+			} break;
+
+			case TokenType_Var: {
+				parser_advance(parser);
+				ParseFrame frame = { 0 };
+				frame.type = ParseFrame_Var;
+				frame.operand_start = (u32)parser->bindings.len;
+				gb_array_append(&parser->frames, &frame);
+				parser_var_bindings(parser, gb_array_get(&parser->frames, parser->frames.len - 1));
+				expect_operand = true;
+			} break;
+
+			default: {
+				GB_ASSERT_MSG(
+					parser->token->type == TokenType_Ascii
+						&& (parser->token->ascii == '(' || !ascii_is_syntax(parser->token->ascii)),
+					"expected an expression"
+				);
+				ParseFrame frame = { 0 };
+				if (parser->token->ascii == '(') {
+					frame.type = ParseFrame_Paren;
+				} else {
+					frame.type = ParseFrame_Unary;
+					frame.op = parser->token->ascii;
+				}
+				gb_array_append(&parser->frames, &frame);
+				parser_advance(parser);
+				expect_operand = true;
+			} break;
+			}
 
-	gb_arena_init_from_allocator(&llvm_backend.arena, heap_allocator, gb_megabytes(4));
-	llvm_backend.arena_allocator = gb_arena_allocator(&llvm_backend.arena);
+		} else {
+			i32 precedence = get_cur_tok_precedence(parser);
+			ParseFrame *top = parser_top_frame(parser, frames_base);
+
+			if (precedence >= 0) {
+				// NOTE(khvorov) Left-associative, equal precedence reduces first
+				while (top != 0 && top->type == ParseFrame_Binary && top->precedence >= precedence) {
+					parser_reduce_binary(parser);
+					top = parser_top_frame(parser, frames_base);
+				}
+				ParseFrame frame = { 0 };
+				frame.type = ParseFrame_Binary;
+				frame.op = parser->token->ascii;
+				frame.precedence = precedence;
+				gb_array_append(&parser->frames, &frame);
+				parser_advance(parser);
+				expect_operand = true;
+			} else {
+				while (top != 0 && top->type == ParseFrame_Binary) {
+					parser_reduce_binary(parser);
+					top = parser_top_frame(parser, frames_base);
+				}
+
+				if (top == 0) {
+					done = true;
+				} else if (top->type == ParseFrame_Paren) {
+					GB_ASSERT_MSG(parser_token_is_ascii(parser, ')'), "expected ')'");
+					parser_advance(parser);
+					gb_array_pop(&parser->frames);
+					parser_push_operand(parser, parser_pop_operand(parser), frames_base);
+				} else if (top->type == ParseFrame_If || top->type == ParseFrame_For || top->type == ParseFrame_Var) {
+					expect_operand = parser_next_stage(parser, frames_base);
+				} else {
+					// NOTE(khvorov) Finished an argument, there is another one
+					// unless the call closes here
+					GB_ASSERT(top->type == ParseFrame_Call);
+					if (parser_token_is_ascii(parser, ')')) {
+						parser_advance(parser);
+						parser_reduce_call(parser, frames_base);
+					} else {
+						expect_operand = true;
+					}
+				}
+			}
+		}
+	}
 
-	lb_function(&llvm_backend, top_level_node);
-	LLVMDumpModule(llvm_backend.module);
+	GB_ASSERT(parser->frames.len == frames_base);
+	GB_ASSERT(parser->operands.len == operands_base + 1);
+	AstExpr result = parser_pop_operand(parser);
+	return result;
+}
+
+static AstPrototype *
+parse_prototype(AstParser *parser) {
+	AstPrototype *proto = gb_alloc_item(parser->arena_allocator, AstPrototype);
+	gb_zero_item(proto);
+
+	switch (parser->token->type) {
+	case TokenType_Identifier: {
+		proto->kind = AstPrototypeKind_Function;
+		proto->name = parser_identifier(parser);
+		parser_advance(parser);
+	} break;
+
+	case TokenType_Unary:
+	case TokenType_Binary: {
+		b32 is_unary = parser->token->type == TokenType_Unary;
+		proto->kind = is_unary ? AstPrototypeKind_Unary : AstPrototypeKind_Binary;
+		parser_advance(parser);
+
+		GB_ASSERT_MSG(parser->token->type == TokenType_Ascii, "expected an operator");
+		char op = parser->token->ascii;
+		GB_ASSERT_MSG(!ascii_is_syntax(op), "'%c' is part of the syntax and cannot be an operator", op);
+		GB_ASSERT_MSG(
+			is_unary || !ascii_is_builtin_binary(op),
+			"binary '%c' is built in and cannot be redefined", op
+		);
+		proto->name = symbol_intern_operator(&global_symbols, is_unary ? "unary" : "binary", op);
+		parser_advance(parser);
+
+		if (!is_unary) {
+			proto->precedence = 30;
+			if (parser->token->type == TokenType_Number) {
+				f64 precedence = parser->token->number;
+				GB_ASSERT_MSG(precedence >= 1 && precedence <= 100, "operator precedence must be 1..100");
+				proto->precedence = (u8)precedence;
+				parser_advance(parser);
+			}
+			// NOTE(khvorov) Takes effect for everything parsed from here on
+			parser->binary_precedence[(u8)op] = proto->precedence;
+		}
+	} break;
+
+	default: {
+		GB_PANIC("expected a function name");
+	} break;
+	}
+
+	GB_ASSERT(parser->token->type == TokenType_Ascii && parser->token->ascii == '(');
+	parser_advance(parser);
+
+	// NOTE(khvorov) Parameters are stored contiguously
+	isize param_cap = 0;
+	while (parser->token->type != TokenType_Ascii || parser->token->ascii != ')') {
+		if (proto->param_count == param_cap) {
+			isize new_param_cap = gb_array_grow_formula(param_cap);
+			proto->param = gb_resize(
+				parser->arena_allocator, proto->param,
+				param_cap * gb_size_of(AstParameter), new_param_cap * gb_size_of(AstParameter)
+			);
+			param_cap = new_param_cap;
+		}
+		AstParameter *param = proto->param + proto->param_count;
+		param->name = parser_identifier(parser);
+		proto->param_count += 1;
+		parser_advance(parser);
+	}
+
+	GB_ASSERT(parser->token->type == TokenType_Ascii && parser->token->ascii == ')');
+	parser_advance(parser);
+
+	GB_ASSERT_MSG(proto->kind != AstPrototypeKind_Unary || proto->param_count == 1, "unary operators take 1 parameter");
+	GB_ASSERT_MSG(proto->kind != AstPrototypeKind_Binary || proto->param_count == 2, "binary operators take 2 parameters");
+
+	return proto;
+}
+
+static AstFunction *
+parse_definition(AstParser *parser) {
+	GB_ASSERT(parser->token->type == TokenType_Def);
+	parser_advance(parser);
+
+	AstFunction *result = gb_alloc_item(parser->arena_allocator, AstFunction);
+	result->proto = parse_prototype(parser);
+	result->proto->has_body = true;
+	result->body = parse_expr(parser);
+
+	return result;
+}
+
+static AstPrototype *
+parse_extern(AstParser *parser) {
+	GB_ASSERT(parser->token->type == TokenType_Extern);
+	parser_advance(parser);
+
+	AstPrototype *proto = parse_prototype(parser);
+	return proto;
+}
+
+static AstFunction *
+parse_top_level_expr(AstParser *parser) {
+	AstFunction *fun = gb_alloc_item(parser->arena_allocator, AstFunction);
+	fun->proto = gb_alloc_item(parser->arena_allocator, AstPrototype);
+	gb_zero_item(fun->proto);
+	fun->proto->name = symbol_intern_cstring(&global_symbols, LB_ANON_EXPR_NAME);
+	fun->body = parse_expr(parser);
+	return fun;
+}
+
+//
+// SECTION Scopes
+//
+
+static void
+scope_table_init(ScopeTable *table, gbAllocator allocator) {
+	gb_zero_item(table);
+	gb_htab_init_Symbol_ScopeHead(&table->heads, allocator);
+	gb_array_init_ScopeBinding(&table->bindings, allocator);
+	gb_array_init_isize(&table->frames, allocator);
+	table->generation = 1;
+}
+
+static void
+scope_table_destroy(ScopeTable *table) {
+	gb_htab_destroy_Symbol_ScopeHead(&table->heads);
+	gb_array_free_ScopeBinding(&table->bindings);
+	gb_array_free_isize(&table->frames);
+}
+
+// NOTE(khvorov) Drops every binding in constant time. The heads only get
+// cleared once the generation wraps around.
+static void
+scope_table_reset(ScopeTable *table) {
+	gb_array_clear_ScopeBinding(&table->bindings);
+	gb_array_clear_isize(&table->frames);
+	table->generation += 1;
+	if (table->generation == 0) {
+		gb_htab_clear_Symbol_ScopeHead(&table->heads);
+		table->generation = 1;
+	}
+}
+
+static ScopeHead *
+scope_head(ScopeTable *table, Symbol name) {
+	ScopeHead *result = gb_htab_get_Symbol_ScopeHead(&table->heads, name);
+	if (result != 0 && result->generation != table->generation) {
+		result = 0;
+	}
+	return result;
+}
+
+static void
+scope_bind(ScopeTable *table, Symbol name, LLVMValueRef slot) {
+	ScopeHead *old_head = scope_head(table, name);
+	ScopeBinding binding = { name, old_head != 0 ? old_head->binding : 0, slot };
+	gb_array_append_ScopeBinding(&table->bindings, binding);
+	ScopeHead head = { table->generation, (u32)table->bindings.len };
+	gb_htab_set_Symbol_ScopeHead(&table->heads, name, head);
+}
+
+// NOTE(khvorov) 0 when the name is not bound
+static LLVMValueRef
+scope_lookup(ScopeTable *table, Symbol name) {
+	ScopeHead *head = scope_head(table, name);
+	LLVMValueRef result = 0;
+	if (head != 0 && head->binding != 0) {
+		result = table->bindings.ptr[head->binding - 1].slot;
+	}
+	return result;
+}
+
+static void
+scope_push(ScopeTable *table) {
+	gb_array_append_isize(&table->frames, table->bindings.len);
+}
+
+// NOTE(khvorov) Unbinds everything bound since the matching push, innermost
+// first, so that every name gets back the binding it had before
+static void
+scope_pop(ScopeTable *table) {
+	GB_ASSERT(table->frames.len > 0);
+	isize frame_start = gb_array_pop_isize(&table->frames);
+	while (table->bindings.len > frame_start) {
+		ScopeBinding binding = gb_array_pop_ScopeBinding(&table->bindings);
+		ScopeHead *head = scope_head(table, binding.name);
+		head->binding = binding.shadowed;
+	}
+}
+
+//
+// SECTION LLVM
+//
+
+static LLVMValueRef lb_node(LLVMBackend *lb, AstExpr expr);
+static LLVMValueRef lb_get_function(LLVMBackend *lb, Symbol name);
+
+static LLVMTypeRef
+lb_function_type(LLVMBackend *lb, isize param_count) {
+	gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&lb->arena);
+
+	LLVMTypeRef *arg_types = gb_alloc_array(lb->arena_allocator, LLVMTypeRef, param_count);
+	LLVMTypeRef llvm_double = LLVMDoubleTypeInContext(lb->ctx);
+	for (isize arg_type_index = 0; arg_type_index < param_count; arg_type_index += 1) {
+		arg_types[arg_type_index] = llvm_double;
+	}
+	LLVMTypeRef result = LLVMFunctionType(llvm_double, arg_types, (unsigned int)param_count, false);
+
+	gb_temp_arena_memory_end(temp_memory);
+	return result;
+}
+
+// NOTE(khvorov) Generated code runs in this process so host addresses can be
+// baked straight into it
+static LLVMValueRef
+lb_const_pointer(LLVMBackend *lb, void *ptr, LLVMTypeRef type) {
+	LLVMTypeRef type_intptr = LLVMIntTypeInContext(lb->ctx, 8 * sizeof(void *));
+	LLVMValueRef result = LLVMConstIntToPtr(LLVMConstInt(type_intptr, (uintptr)ptr, false), type);
+	return result;
+}
+
+static TierFunction *
+lb_tier_function(LLVMBackend *lb, Symbol name) {
+	TierFunction *result = 0;
+	if (lb->tiering != 0) {
+		TierFunction **find_result = gb_htab_get(&lb->tiering->functions, &name);
+		if (find_result != 0) {
+			result = *find_result;
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) With tiered compilation, calls to defined functions go through
+// their entry so that they pick up the optimized version once it is ready.
+// The optimized version calls itself directly. Returns 0 for unknown functions.
+static LLVMValueRef
+lb_build_call(LLVMBackend *lb, Symbol name, LLVMValueRef *args, isize arg_count, char *value_name) {
+	LLVMValueRef result = 0;
+	TierFunction *tier_function = lb_tier_function(lb, name);
+
+	if (tier_function != 0 && tier_function != lb->optimizing) {
+		GB_ASSERT(tier_function->fun->proto->param_count == arg_count);
+		LLVMTypeRef fun_type = lb_function_type(lb, arg_count);
+		LLVMTypeRef fun_pointer_type = LLVMPointerType(fun_type, 0);
+		LLVMValueRef entry = lb_const_pointer(lb, &tier_function->entry, LLVMPointerType(fun_pointer_type, 0));
+		LLVMValueRef callee = LLVMBuildLoad2(lb->builder, fun_pointer_type, entry, "entry");
+		LLVMSetOrdering(callee, LLVMAtomicOrderingMonotonic);
+		LLVMSetAlignment(callee, sizeof(void *));
+		result = LLVMBuildCall2(lb->builder, fun_type, callee, args, (unsigned int)arg_count, value_name);
+	} else {
+		LLVMValueRef callee = lb_get_function(lb, name);
+		if (callee != 0) {
+			GB_ASSERT(LLVMCountParams(callee) == arg_count);
+			result = LLVMBuildCall(lb->builder, callee, args, (unsigned int)arg_count, value_name);
+		}
+	}
+
+	return result;
+}
+
+static LLVMValueRef
+lb_number(LLVMBackend *lb, AstNumber *number) {
+	f64 val = number->val;
+	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+	LLVMValueRef llvm_val = LLVMConstReal(type_double, val);
+	return llvm_val;
+}
+
+// NOTE(khvorov) Every variable lives in a stack slot at the start of the entry
+// block. mem2reg turns the slots back into registers once the function is done.
+static LLVMValueRef
+lb_entry_alloca(LLVMBackend *lb, Symbol name) {
+	LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(lb->builder));
+	LLVMBasicBlockRef entry_block = LLVMGetEntryBasicBlock(function);
+	LLVMValueRef first_instruction = LLVMGetFirstInstruction(entry_block);
+	if (first_instruction != 0) {
+		LLVMPositionBuilderBefore(lb->alloca_builder, first_instruction);
+	} else {
+		LLVMPositionBuilderAtEnd(lb->alloca_builder, entry_block);
+	}
+	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+	LLVMValueRef result = LLVMBuildAlloca(lb->alloca_builder, type_double, symbol_cstring(&global_symbols, name));
+	return result;
+}
+
+static LLVMValueRef
+lb_variable_slot(LLVMBackend *lb, Symbol name) {
+	LLVMValueRef result = scope_lookup(&lb->named_values, name);
+	GB_ASSERT_MSG(result != 0, "unknown variable %s", symbol_cstring(&global_symbols, name));
+	return result;
+}
+
+static LLVMValueRef
+lb_variable(LLVMBackend *lb, AstVariable *variable) {
+	LLVMValueRef slot = lb_variable_slot(lb, variable->name);
+	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+	LLVMValueRef result = LLVMBuildLoad2(lb->builder, type_double, slot, symbol_cstring(&global_symbols, variable->name));
+	return result;
+}
+
+// NOTE(khvorov) Evaluates to the assigned value
+static LLVMValueRef
+lb_assign(LLVMBackend *lb, AstBinary *binary, LLVMValueRef rhs) {
+	GB_ASSERT_MSG(ast_type(binary->lhs) == AstType_Variable, "destination of '=' must be a variable");
+	AstVariable *variable = ast_get(&lb->ast->variables, binary->lhs);
+	LLVMBuildStore(lb->builder, rhs, lb_variable_slot(lb, variable->name));
+	return rhs;
+}
+
+static LLVMValueRef
+lb_binary(LLVMBackend *lb, AstBinary *binary, LLVMValueRef lhs, LLVMValueRef rhs) {
+	LLVMValueRef result = 0;
+
+	switch (binary->op) {
+
+	case '+': {
+		result = LLVMBuildFAdd(lb->builder, lhs, rhs, "addtmp");
+	} break;
+
+	case '-': {
+		result = LLVMBuildFSub(lb->builder, lhs, rhs, "subtmp");
+	} break;
+
+	case '*': {
+		result = LLVMBuildFMul(lb->builder, lhs, rhs, "multmp");
+	} break;
+
+	case '<': {
+		LLVMValueRef logical = LLVMBuildFCmp(lb->builder, LLVMRealULT, lhs, rhs, "cmptmp");
+		LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+		result = LLVMBuildUIToFP(lb->builder, logical, type_double, "booltemp");
+	} break;
+
+	default: {
+		LLVMValueRef args[] = { lhs, rhs };
+		result = lb_build_call(lb, binary->function, args, gb_count_of(args), "binop");
+		GB_ASSERT_MSG(result != 0, "unknown binary operator '%c'", binary->op);
+	}
+	}
+
+	return result;
+}
+
+static LLVMValueRef
+lb_unary(LLVMBackend *lb, AstUnary *unary, LLVMValueRef operand) {
+	LLVMValueRef result = lb_build_call(lb, unary->function, &operand, 1, "unop");
+	GB_ASSERT_MSG(result != 0, "unknown unary operator '%c'", unary->op);
+	return result;
+}
+
+static LLVMValueRef
+lb_call(LLVMBackend *lb, AstCall *call, LLVMValueRef *arg_vals) {
+	LLVMValueRef result = lb_build_call(lb, call->callee, arg_vals, call->arg_count, "calltmp");
+	GB_ASSERT_MSG(result != 0, "unknown function %s", symbol_cstring(&global_symbols, call->callee));
+	return result;
+}
+
+static LLVMValueRef
+lb_proto(LLVMBackend *lb, AstPrototype *proto) {
+	LLVMTypeRef fun_type = lb_function_type(lb, proto->param_count);
+
+	char *fun_name = symbol_cstring(&global_symbols, proto->name);
+	LLVMValueRef llvm_fun = LLVMAddFunction(lb->module, fun_name, fun_type);
+
+	for (isize arg_index = 0; arg_index < proto->param_count; arg_index += 1) {
+		LLVMValueRef llvm_param = LLVMGetParam(llvm_fun, (unsigned int)arg_index);
+		String param_name = symbol_string(&global_symbols, proto->param[arg_index].name);
+		LLVMSetValueName2(llvm_param, param_name.ptr, param_name.len);
+	}
+
+	return llvm_fun;
+}
+
+// NOTE(khvorov) Every top-level item gets its own module, so functions defined
+// in earlier modules are redeclared from their remembered prototypes
+static LLVMValueRef
+lb_get_function(LLVMBackend *lb, Symbol name) {
+	LLVMValueRef result = LLVMGetNamedFunction(lb->module, symbol_cstring(&global_symbols, name));
+
+	if (result == 0) {
+		AstPrototype **proto = gb_htab_get(lb->function_protos, &name);
+		if (proto != 0) {
+			result = lb_proto(lb, *proto);
+		}
+	}
+
+	return result;
+}
+
+static LLVMValueRef
+lb_extern(LLVMBackend *lb, AstPrototype *proto) {
+	AstPrototype **known_proto = gb_htab_get(lb->function_protos, &proto->name);
+	if (known_proto == 0 || *known_proto != proto) {
+		// NOTE(khvorov) The main thread registers every prototype before
+		// codegen workers start, they only ever read the table
+		GB_ASSERT_MSG(!lb->function_protos_read_only, "codegen worker got an unregistered prototype");
+		gb_htab_set(lb->function_protos, &proto->name, &proto);
+	}
+	LLVMValueRef result = lb_get_function(lb, proto->name);
+	return result;
+}
+
+static void tier_up(TierFunction *function);
+
+#ifndef TIER_UP_CALL_COUNT
+#define TIER_UP_CALL_COUNT 1000
+#endif
+
+// NOTE(khvorov) Only the main thread runs generated code so the counter does
+// not need to be atomic
+static void
+lb_count_call(LLVMBackend *lb, TierFunction *function) {
+	LLVMTypeRef type_i32 = LLVMInt32TypeInContext(lb->ctx);
+	LLVMValueRef counter = lb_const_pointer(lb, &function->call_count, LLVMPointerType(type_i32, 0));
+	LLVMValueRef count = LLVMBuildLoad2(lb->builder, type_i32, counter, "calls");
+	LLVMValueRef next = LLVMBuildAdd(lb->builder, count, LLVMConstInt(type_i32, 1, false), "nextcalls");
+	LLVMBuildStore(lb->builder, next, counter);
+	LLVMValueRef hot = LLVMBuildICmp(lb->builder, LLVMIntEQ, next, LLVMConstInt(type_i32, TIER_UP_CALL_COUNT, false), "hot");
+
+	LLVMValueRef llvm_fun = LLVMGetBasicBlockParent(LLVMGetInsertBlock(lb->builder));
+	LLVMBasicBlockRef tier_up_block = LLVMAppendBasicBlockInContext(lb->ctx, llvm_fun, "tierup");
+	LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(lb->ctx, llvm_fun, "body");
+	LLVMBuildCondBr(lb->builder, hot, tier_up_block, body_block);
+
+	LLVMPositionBuilderAtEnd(lb->builder, tier_up_block);
+	LLVMTypeRef type_pointer = LLVMPointerType(LLVMInt8TypeInContext(lb->ctx), 0);
+	LLVMTypeRef tier_up_type = LLVMFunctionType(LLVMVoidTypeInContext(lb->ctx), &type_pointer, 1, false);
+	LLVMValueRef tier_up_proc = lb_const_pointer(lb, (void *)tier_up, LLVMPointerType(tier_up_type, 0));
+	LLVMValueRef tier_up_arg = lb_const_pointer(lb, function, type_pointer);
+	LLVMBuildCall2(lb->builder, tier_up_type, tier_up_proc, &tier_up_arg, 1, "");
+	LLVMBuildBr(lb->builder, body_block);
+
+	LLVMPositionBuilderAtEnd(lb->builder, body_block);
+}
+
+static LLVMValueRef
+lb_function(LLVMBackend *lb, AstFunction *fun) {
+	gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&lb->arena);
+
+	LLVMValueRef llvm_proto = lb_extern(lb, fun->proto);
+	GB_ASSERT(LLVMCountBasicBlocks(llvm_proto) == 0);
+
+	LLVMBasicBlockRef entry_block = LLVMAppendBasicBlockInContext(lb->ctx, llvm_proto, "entry");
+	LLVMPositionBuilderAtEnd(lb->builder, entry_block);
+
+	scope_table_reset(&lb->named_values);
+	for (isize arg_index = 0; arg_index < fun->proto->param_count; arg_index += 1) {
+		LLVMValueRef llvm_param = LLVMGetParam(llvm_proto, (unsigned int)arg_index);
+		Symbol param_name = fun->proto->param[arg_index].name;
+		LLVMValueRef slot = lb_entry_alloca(lb, param_name);
+		LLVMBuildStore(lb->builder, llvm_param, slot);
+		scope_bind(&lb->named_values, param_name, slot);
+	}
+
+	if (lb->optimizing == 0) {
+		TierFunction *tier_function = lb_tier_function(lb, fun->proto->name);
+		if (tier_function != 0) {
+			lb_count_call(lb, tier_function);
+		}
+	}
+
+	LLVMValueRef llvm_body_return = lb_node(lb, fun->body);
+	LLVMBuildRet(lb->builder, llvm_body_return);
+
+	LLVMVerifyFunction(llvm_proto, LLVMAbortProcessAction);
+	LLVMRunFunctionPassManager(lb->function_passes, llvm_proto);
+
+	gb_temp_arena_memory_end(temp_memory);
+	return llvm_proto;
+}
+
+static void
+lb_push_work(LLVMBackend *lb, AstExpr expr, i32 stage) {
+	LbWork work = { expr, stage };
+	gb_array_append(&lb->work, &work);
+}
+
+static void
+lb_push_value(LLVMBackend *lb, LLVMValueRef value) {
+	gb_array_append(&lb->values, &value);
+}
+
+static LLVMValueRef
+lb_pop_value(LLVMBackend *lb) {
+	GB_ASSERT(lb->values.len > 0);
+	LLVMValueRef result = *(LLVMValueRef *)gb_array_get(&lb->values, lb->values.len - 1);
+	gb_array_pop(&lb->values);
+	return result;
+}
+
+static LLVMBasicBlockRef
+lb_append_block(LLVMBackend *lb, LLVMBasicBlockRef block) {
+	LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(lb->builder));
+	LLVMAppendExistingBasicBlock(function, block);
+	LLVMPositionBuilderAtEnd(lb->builder, block);
+	return block;
+}
+
+// NOTE(khvorov) Blocks that are needed across stages wait on the value stack
+static LLVMBasicBlockRef
+lb_pop_block(LLVMBackend *lb) {
+	LLVMBasicBlockRef result = LLVMValueAsBasicBlock(lb_pop_value(lb));
+	return result;
+}
+
+// NOTE(khvorov) Called once per stage. Returns the value of the if after the
+// last one, 0 before that.
+static LLVMValueRef
+lb_if(LLVMBackend *lb, AstExpr expr, AstIf *node, i32 stage) {
+	LLVMValueRef result = 0;
+	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+
+	switch (stage) {
+	case 0: {
+		lb_push_work(lb, expr, 1);
+		lb_push_work(lb, node->cond, 0);
+	} break;
+
+	case 1: {
+		LLVMValueRef cond = lb_pop_value(lb);
+		LLVMValueRef cond_bool = LLVMBuildFCmp(lb->builder, LLVMRealONE, cond, LLVMConstReal(type_double, 0), "ifcond");
+		LLVMBasicBlockRef then_block = LLVMCreateBasicBlockInContext(lb->ctx, "then");
+		LLVMBasicBlockRef else_block = LLVMCreateBasicBlockInContext(lb->ctx, "else");
+		LLVMBasicBlockRef merge_block = LLVMCreateBasicBlockInContext(lb->ctx, "ifcont");
+		LLVMBuildCondBr(lb->builder, cond_bool, then_block, else_block);
+		lb_append_block(lb, then_block);
+		lb_push_value(lb, LLVMBasicBlockAsValue(merge_block));
+		lb_push_value(lb, LLVMBasicBlockAsValue(else_block));
+		lb_push_work(lb, expr, 2);
+		lb_push_work(lb, node->then_branch, 0);
+	} break;
+
+	case 2: {
+		// NOTE(khvorov) The then branch may have ended up in a different block
+		LLVMValueRef then_value = lb_pop_value(lb);
+		LLVMBasicBlockRef then_end = LLVMGetInsertBlock(lb->builder);
+		LLVMBasicBlockRef else_block = lb_pop_block(lb);
+		LLVMBasicBlockRef merge_block = LLVMValueAsBasicBlock(*(LLVMValueRef *)gb_array_get(&lb->values, lb->values.len - 1));
+		LLVMBuildBr(lb->builder, merge_block);
+		lb_append_block(lb, else_block);
+		lb_push_value(lb, then_value);
+		lb_push_value(lb, LLVMBasicBlockAsValue(then_end));
+		lb_push_work(lb, expr, 3);
+		lb_push_work(lb, node->else_branch, 0);
+	} break;
+
+	case 3: {
+		LLVMValueRef else_value = lb_pop_value(lb);
+		LLVMBasicBlockRef else_end = LLVMGetInsertBlock(lb->builder);
+		LLVMBasicBlockRef then_end = lb_pop_block(lb);
+		LLVMValueRef then_value = lb_pop_value(lb);
+		LLVMBasicBlockRef merge_block = lb_pop_block(lb);
+		LLVMBuildBr(lb->builder, merge_block);
+		lb_append_block(lb, merge_block);
+
+		result = LLVMBuildPhi(lb->builder, type_double, "iftmp");
+		LLVMValueRef incoming_values[] = { then_value, else_value };
+		LLVMBasicBlockRef incoming_blocks[] = { then_end, else_end };
+		LLVMAddIncoming(result, incoming_values, incoming_blocks, 2);
+	} break;
+	}
+
+	return result;
+}
+
+// NOTE(khvorov) The body runs at least once. The end condition is checked
+// after the body with the loop variable still at its old value. The loop
+// variable gets a stack slot of its own that shadows any outer binding of the
+// same name while the loop is generated. Always evaluates to 0.
+static LLVMValueRef
+lb_for(LLVMBackend *lb, AstExpr expr, AstFor *node, i32 stage) {
+	LLVMValueRef result = 0;
+	LLVMTypeRef type_double = LLVMDoubleTypeInContext(lb->ctx);
+
+	switch (stage) {
+	case 0: {
+		lb_push_work(lb, expr, 1);
+		lb_push_work(lb, node->start, 0);
+	} break;
+
+	case 1: {
+		LLVMValueRef start = lb_pop_value(lb);
+		LLVMValueRef slot = lb_entry_alloca(lb, node->var);
+		LLVMBuildStore(lb->builder, start, slot);
+		LLVMBasicBlockRef loop_block = LLVMCreateBasicBlockInContext(lb->ctx, "loop");
+		LLVMBuildBr(lb->builder, loop_block);
+		lb_append_block(lb, loop_block);
+
+		lb_push_value(lb, LLVMBasicBlockAsValue(loop_block));
+		lb_push_value(lb, slot);
+		scope_push(&lb->named_values);
+		scope_bind(&lb->named_values, node->var, slot);
+
+		lb_push_work(lb, expr, 2);
+		lb_push_work(lb, node->body, 0);
+	} break;
+
+	case 2: {
+		lb_pop_value(lb);
+		lb_push_work(lb, expr, 3);
+		if (node->step != 0) {
+			lb_push_work(lb, node->step, 0);
+		} else {
+			lb_push_value(lb, LLVMConstReal(type_double, 1));
+		}
+	} break;
+
+	case 3: {
+		lb_push_work(lb, expr, 4);
+		lb_push_work(lb, node->end, 0);
+	} break;
+
+	case 4: {
+		LLVMValueRef end = lb_pop_value(lb);
+		LLVMValueRef step = lb_pop_value(lb);
+		LLVMValueRef slot = lb_pop_value(lb);
+		LLVMBasicBlockRef loop_block = lb_pop_block(lb);
+
+		// NOTE(khvorov) The body may have assigned to the loop variable
+		LLVMValueRef variable = LLVMBuildLoad2(lb->builder, type_double, slot, symbol_cstring(&global_symbols, node->var));
+		LLVMValueRef next = LLVMBuildFAdd(lb->builder, variable, step, "nextvar");
+		LLVMBuildStore(lb->builder, next, slot);
+
+		LLVMValueRef end_bool = LLVMBuildFCmp(lb->builder, LLVMRealONE, end, LLVMConstReal(type_double, 0), "loopcond");
+		LLVMBasicBlockRef after_block = LLVMCreateBasicBlockInContext(lb->ctx, "afterloop");
+		LLVMBuildCondBr(lb->builder, end_bool, loop_block, after_block);
+		lb_append_block(lb, after_block);
+
+		scope_pop(&lb->named_values);
+		result = LLVMConstReal(type_double, 0);
+	} break;
+	}
+
+	return result;
+}
+
+// NOTE(khvorov) Stage n binds the value of initializer n - 1 and then
+// generates initializer n, so initializers see the bindings before them. All
+// the bindings go in one scope that is popped once the body is done.
+static LLVMValueRef
+lb_var(LLVMBackend *lb, AstExpr expr, AstVar *node, i32 stage) {
+	LLVMValueRef result = 0;
+	AstVarBinding *bindings = gb_array_get(&lb->ast->var_bindings, node->binding_start);
+
+	if (stage == 0) {
+		scope_push(&lb->named_values);
+	}
+
+	if (stage > 0 && stage <= (i32)node->binding_count) {
+		LLVMValueRef init = lb_pop_value(lb);
+		AstVarBinding *binding = bindings + stage - 1;
+		LLVMValueRef slot = lb_entry_alloca(lb, binding->name);
+		LLVMBuildStore(lb->builder, init, slot);
+		scope_bind(&lb->named_values, binding->name, slot);
+	}
+
+	if (stage < (i32)node->binding_count) {
+		lb_push_work(lb, expr, stage + 1);
+		AstExpr init = bindings[stage].init;
+		if (init != 0) {
+			lb_push_work(lb, init, 0);
+		} else {
+			lb_push_value(lb, LLVMConstReal(LLVMDoubleTypeInContext(lb->ctx), 0));
+		}
+	} else if (stage == (i32)node->binding_count) {
+		lb_push_work(lb, expr, stage + 1);
+		lb_push_work(lb, node->body, 0);
+	} else {
+		result = lb_pop_value(lb);
+		scope_pop(&lb->named_values);
+	}
+
+	return result;
+}
+
+// NOTE(khvorov) Walks the expression with an explicit stack instead of
+// recursing. Children are generated first and leave their values on the value
+// stack for the parent. Nodes with control flow come back once per stage.
+static LLVMValueRef
+lb_node(LLVMBackend *lb, AstExpr expr) {
+	AstPool *ast = lb->ast;
+	isize work_base = lb->work.len;
+	isize values_base = lb->values.len;
+	lb_push_work(lb, expr, 0);
+
+	while (lb->work.len > work_base) {
+		LbWork work = *(LbWork *)gb_array_get(&lb->work, lb->work.len - 1);
+		gb_array_pop(&lb->work);
+		LLVMValueRef value = 0;
+
+		switch (ast_type(work.expr)) {
+		case AstType_None: { GB_PANIC("unexpected AstType_None"); } break;
+		case AstType_Number: { value = lb_number(lb, ast_get(&ast->numbers, work.expr)); } break;
+		case AstType_Variable: { value = lb_variable(lb, ast_get(&ast->variables, work.expr)); } break;
+
+		case AstType_Unary: {
+			AstUnary *unary = ast_get(&ast->unaries, work.expr);
+			if (work.stage == 0) {
+				lb_push_work(lb, work.expr, 1);
+				lb_push_work(lb, unary->operand, 0);
+			} else {
+				value = lb_unary(lb, unary, lb_pop_value(lb));
+			}
+		} break;
+
+		case AstType_Binary: {
+			AstBinary *binary = ast_get(&ast->binaries, work.expr);
+			if (work.stage == 0) {
+				lb_push_work(lb, work.expr, 1);
+				lb_push_work(lb, binary->rhs, 0);
+				// NOTE(khvorov) The destination of an assignment is not read
+				if (binary->op != '=') {
+					lb_push_work(lb, binary->lhs, 0);
+				}
+			} else if (binary->op == '=') {
+				value = lb_assign(lb, binary, lb_pop_value(lb));
+			} else {
+				LLVMValueRef rhs = lb_pop_value(lb);
+				LLVMValueRef lhs = lb_pop_value(lb);
+				value = lb_binary(lb, binary, lhs, rhs);
+			}
+		} break;
+
+		case AstType_Call: {
+			AstCall *call = ast_get(&ast->calls, work.expr);
+			if (work.stage == 0) {
+				lb_push_work(lb, work.expr, 1);
+				AstExpr *args = gb_array_get(&ast->args, call->arg_start);
+				for (isize arg_index = (isize)call->arg_count - 1; arg_index >= 0; arg_index -= 1) {
+					lb_push_work(lb, args[arg_index], 0);
+				}
+			} else {
+				isize args_start = lb->values.len - call->arg_count;
+				value = lb_call(lb, call, gb_array_get(&lb->values, args_start));
+				gb_array_resize(&lb->values, args_start);
+			}
+		} break;
+
+		case AstType_If: { value = lb_if(lb, work.expr, ast_get(&ast->ifs, work.expr), work.stage); } break;
+		case AstType_For: { value = lb_for(lb, work.expr, ast_get(&ast->fors, work.expr), work.stage); } break;
+		case AstType_Var: { value = lb_var(lb, work.expr, ast_get(&ast->vars, work.expr), work.stage); } break;
+		}
+
+		if (value != 0) {
+			gb_array_append(&lb->values, &value);
+		}
+	}
+
+	GB_ASSERT(lb->values.len == values_base + 1);
+	LLVMValueRef result = lb_pop_value(lb);
+	return result;
+}
+
+// NOTE(khvorov) The arena only holds scratch arrays and chains on more blocks
+// if it has to. Backends get created while generated code runs, so this is
+// kept small.
+#define LB_ARENA_BLOCK_SIZE gb_kilobytes(64)
+
+static void
+lb_init(LLVMBackend *lb, LLVMContextRef ctx, gbAllocator allocator) {
+	gb_zero_item(lb);
+	lb->ctx = ctx;
+	lb->builder = LLVMCreateBuilderInContext(ctx);
+	lb->alloca_builder = LLVMCreateBuilderInContext(ctx);
+	scope_table_init(&lb->named_values, allocator);
+	gb_arena_init_from_allocator(&lb->arena, allocator, LB_ARENA_BLOCK_SIZE);
+	lb->arena_allocator = gb_arena_allocator(&lb->arena);
+	gb_array_init(&lb->work, allocator, sizeof(LbWork));
+	gb_array_init(&lb->values, allocator, sizeof(LLVMValueRef));
+	gb_array_init(&lb->unresolved, allocator, sizeof(AstFunction *));
+}
+
+// NOTE(khvorov) Leaves the context and the modules alone
+static void
+lb_destroy(LLVMBackend *lb) {
+	LLVMDisposeBuilder(lb->builder);
+	LLVMDisposeBuilder(lb->alloca_builder);
+	scope_table_destroy(&lb->named_values);
+	gb_arena_free(&lb->arena);
+	gb_array_free(&lb->work);
+	gb_array_free(&lb->values);
+	gb_array_free(&lb->unresolved);
+}
+
+//
+// SECTION JIT
+//
+
+// NOTE(khvorov) mem2reg and SROA run at every level since all variables start
+// out in stack slots. -O1 adds the cheap function passes. -O2 and up also run
+// LLVM's standard module pipeline on each module before it goes to the JIT.
+static void
+lb_begin_module(LLVMBackend *lb) {
+	lb->module = LLVMModuleCreateWithNameInContext("KaleidoscopeModule", lb->ctx);
+	LLVMSetModuleDataLayout(lb->module, LLVMGetExecutionEngineTargetData(lb->engine));
+
+	lb->function_passes = LLVMCreateFunctionPassManagerForModule(lb->module);
+	LLVMAddPromoteMemoryToRegisterPass(lb->function_passes);
+	LLVMAddScalarReplAggregatesPass(lb->function_passes);
+	if (lb->opt_level >= 1) {
+		LLVMAddInstructionCombiningPass(lb->function_passes);
+		LLVMAddReassociatePass(lb->function_passes);
+		LLVMAddGVNPass(lb->function_passes);
+		LLVMAddCFGSimplificationPass(lb->function_passes);
+	}
+	LLVMInitializeFunctionPassManager(lb->function_passes);
+}
+
+// NOTE(khvorov) Costs address space only. Code refers to its constants
+// relative to its own address, which keeps all of it within 2GB.
+#define JIT_MEMORY_RESERVE gb_gigabytes(1)
+
+static void
+jit_memory_init(JitMemory *memory) {
+	gb_zero_item(memory);
+	memory->page_size = gb_virtual_memory_page_size(0);
+	memory->reserved = JIT_MEMORY_RESERVE;
+#if defined(GB_SYSTEM_WINDOWS)
+	memory->base = VirtualAlloc(0, memory->reserved, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	memory->base = mmap(0, memory->reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory->base == MAP_FAILED) {
+		memory->base = 0;
+	}
+#endif
+	GB_ASSERT_MSG(memory->base != 0, "could not reserve JIT memory");
+
+	// NOTE(khvorov) Half for code, a quarter for each kind of data
+	isize offset = 0;
+	for (JitSection section = 0; section < JitSection_Count; section++) {
+		JitArena *arena = memory->arenas + section;
+		arena->base = memory->base + offset;
+		arena->size = section == JitSection_Code ? memory->reserved / 2 : memory->reserved / 4;
+		offset += arena->size;
+	}
+}
+
+static isize
+jit_memory_page_align(JitMemory *memory, isize offset) {
+	isize result = (offset + memory->page_size - 1) & ~(memory->page_size - 1);
+	return result;
+}
+
+static b32
+jit_memory_protect(u8 *start, isize size, JitProtect protect_as) {
+	b32 result = true;
+	if (size > 0) {
+#if defined(GB_SYSTEM_WINDOWS)
+		DWORD protect = PAGE_READWRITE;
+		if (protect_as == JitProtect_ReadExecute) {
+			protect = PAGE_EXECUTE_READ;
+		} else if (protect_as == JitProtect_Read) {
+			protect = PAGE_READONLY;
+		}
+		DWORD old_protect = 0;
+		result = VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) != 0
+			&& VirtualProtect(start, size, protect, &old_protect);
+#else
+		int protect = PROT_READ | PROT_WRITE;
+		if (protect_as == JitProtect_ReadExecute) {
+			protect = PROT_READ | PROT_EXEC;
+		} else if (protect_as == JitProtect_Read) {
+			protect = PROT_READ;
+		}
+		result = mprotect(start, size, protect) == 0;
+#endif
+	}
+	return result;
+}
+
+// NOTE(khvorov) Each section is a stack so the code of a top-level expression
+// can be popped after it runs. MCJIT's own memory manager never gives memory
+// back and maps every section separately.
+static u8 *
+jit_memory_alloc(JitMemory *memory, JitSection section, uintptr_t size, unsigned alignment) {
+	JitArena *arena = memory->arenas + section;
+	u8 *result = 0;
+	u8 *start = gb_align_forward(arena->base + arena->used, gb_max(alignment, 16));
+	isize new_used = (start - arena->base) + (isize)size;
+	GB_ASSERT_MSG(new_used <= arena->size, "out of JIT memory");
+	isize start_page = (start - arena->base) & ~(memory->page_size - 1);
+	if (start_page < arena->protected_end) {
+		// NOTE(khvorov) Nothing runs while the JIT writes, so the code already in
+		// the tail page can go without execute access until the next finalize
+		u8 *reopen_start = arena->base + start_page;
+		if (jit_memory_protect(reopen_start, arena->protected_end - start_page, JitProtect_ReadWrite)) {
+			arena->protected_end = start_page;
+		}
+	}
+	isize new_writable_end = jit_memory_page_align(memory, new_used);
+	if (new_writable_end > arena->writable_end) {
+		u8 *writable_start = arena->base + arena->writable_end;
+		if (jit_memory_protect(writable_start, new_writable_end - arena->writable_end, JitProtect_ReadWrite)) {
+			arena->writable_end = new_writable_end;
+		}
+	}
+	if (start_page >= arena->protected_end && new_writable_end <= arena->writable_end) {
+		result = start;
+		arena->used = new_used;
+	}
+	return result;
+}
+
+static JitMemoryMark
+jit_memory_get_mark(JitMemory *memory) {
+	JitMemoryMark result = { 0 };
+	for (JitSection section = 0; section < JitSection_Count; section++) {
+		result.used[section] = memory->arenas[section].used;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Popped pages keep their protection until they are handed out
+// again
+static void
+jit_memory_pop(JitMemory *memory, JitMemoryMark mark) {
+	for (JitSection section = 0; section < JitSection_Count; section++) {
+		memory->arenas[section].used = mark.used[section];
+	}
+}
+
+static u8 *
+jit_memory_alloc_code(void *opaque, uintptr_t size, unsigned alignment, unsigned section_id, const char *section_name) {
+	u8 *result = jit_memory_alloc((JitMemory *)opaque, JitSection_Code, size, alignment);
+	return result;
+}
+
+static u8 *
+jit_memory_alloc_data(
+	void *opaque, uintptr_t size, unsigned alignment, unsigned section_id, const char *section_name, LLVMBool is_read_only
+) {
+	JitSection section = is_read_only ? JitSection_ReadOnly : JitSection_Data;
+	u8 *result = jit_memory_alloc((JitMemory *)opaque, section, size, alignment);
+	return result;
+}
+
+// NOTE(khvorov) Code becomes read-execute and read-only data read-only,
+// including the page used ends in. The next allocation makes that page
+// writable again rather than starting on a fresh one.
+static LLVMBool
+jit_memory_finalize(void *opaque, char **error) {
+	JitMemory *memory = (JitMemory *)opaque;
+	LLVMBool result = 0;
+	for (JitSection section = 0; section < JitSection_Data; section++) {
+		JitArena *arena = memory->arenas + section;
+		JitProtect protect_as = section == JitSection_Code ? JitProtect_ReadExecute : JitProtect_Read;
+		isize new_protected_end = gb_max(jit_memory_page_align(memory, arena->used), arena->protected_end);
+		u8 *start = arena->base + arena->protected_end;
+		if (jit_memory_protect(start, new_protected_end - arena->protected_end, protect_as)) {
+			arena->protected_end = new_protected_end;
+		} else {
+			*error = LLVMCreateMessage("could not protect JIT memory");
+			result = 1;
+		}
+	}
+	return result;
+}
+
+static void
+jit_memory_destroy(void *opaque) {
+	JitMemory *memory = (JitMemory *)opaque;
+#if defined(GB_SYSTEM_WINDOWS)
+	VirtualFree(memory->base, 0, MEM_RELEASE);
+#else
+	munmap(memory->base, memory->reserved);
+#endif
+}
+
+// NOTE(khvorov) Fits any double. gb_printf's %f truncates digits and breaks on
+// values past 2^64, libc rounds.
+#define F64_TEXT_SIZE 400
+
+static char *
+f64_text(char *buffer, f64 value) {
+	snprintf(buffer, F64_TEXT_SIZE, "%f", value);
+	return buffer;
+}
+
+// NOTE(khvorov) Host functions that programs can declare with extern
+static f64
+putchard(f64 x) {
+	gb_printf("%c", (char)x);
+	return 0;
+}
+
+static f64
+printd(f64 x) {
+	char text[F64_TEXT_SIZE];
+	gb_printf("%s\n", f64_text(text, x));
+	return 0;
+}
+
+static void
+lb_jit_init(LLVMBackend *lb) {
+	LLVMLinkInMCJIT();
+	LLVMInitializeNativeTarget();
+	LLVMInitializeNativeAsmPrinter();
+
+	struct LLVMMCJITCompilerOptions options;
+	LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+	// NOTE(khvorov) The optimizing code generator costs far more than the IR
+	// passes, so -O1 keeps the fast one
+	options.OptLevel = lb->opt_level >= 2 ? (unsigned int)lb->opt_level : 0;
+
+	if (lb->opt_level >= 2) {
+		LLVMPassManagerBuilderRef pass_builder = LLVMPassManagerBuilderCreate();
+		LLVMPassManagerBuilderSetOptLevel(pass_builder, (unsigned int)lb->opt_level);
+		lb->module_passes = LLVMCreatePassManager();
+		LLVMPassManagerBuilderPopulateModulePassManager(pass_builder, lb->module_passes);
+		LLVMPassManagerBuilderDispose(pass_builder);
+	}
+
+	LLVMAddSymbol("putchard", (void *)putchard);
+	LLVMAddSymbol("printd", (void *)printd);
+
+	jit_memory_init(&lb->jit_memory);
+	options.MCJMM = LLVMCreateSimpleMCJITMemoryManager(
+		&lb->jit_memory, jit_memory_alloc_code, jit_memory_alloc_data, jit_memory_finalize, jit_memory_destroy
+	);
+
+	// NOTE(khvorov) MCJIT wants a module up front, give it an empty one
+	LLVMModuleRef jit_module = LLVMModuleCreateWithNameInContext("KaleidoscopeJIT", lb->ctx);
+	char *error = 0;
+	if (LLVMCreateMCJITCompilerForModule(&lb->engine, jit_module, &options, sizeof(options), &error)) {
+		GB_PANIC("failed to create JIT: %s", error);
+	}
+
+	lb_begin_module(lb);
+}
+
+static LLVMModuleRef
+lb_end_module(LLVMBackend *lb) {
+	LLVMModuleRef result = lb->module;
+	LLVMFinalizeFunctionPassManager(lb->function_passes);
+	LLVMDisposePassManager(lb->function_passes);
+	lb->module = 0;
+	lb->function_passes = 0;
+	return result;
+}
+
+static LLVMModuleRef
+lb_end_module_optimized(LLVMBackend *lb) {
+	LLVMModuleRef result = lb_end_module(lb);
+	if (lb->module_passes != 0) {
+		LLVMRunPassManager(lb->module_passes, result);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Hands the current module over to the JIT and starts a new one
+static LLVMModuleRef
+lb_jit_add_module(LLVMBackend *lb) {
+	LLVMModuleRef result = lb_end_module_optimized(lb);
+	LLVMAddModule(lb->engine, result);
+	lb_begin_module(lb);
+	return result;
+}
+
+// NOTE(khvorov) Definitions are compiled once the next expression is about to
+// run, so they can call functions defined after them. The module has to be
+// ended already and a new one begun.
+static void
+lb_jit_add_definition_module(LLVMBackend *lb, AstFunction *fun, LLVMModuleRef module) {
+	LLVMAddModule(lb->engine, module);
+	gb_array_append(&lb->unresolved, &fun);
+}
+
+// NOTE(khvorov) Has to happen before an expression is compiled so that the
+// definitions' code sits below it in JIT memory
+static void
+lb_jit_resolve_definitions(LLVMBackend *lb) {
+	for (isize fun_index = 0; fun_index < lb->unresolved.len; fun_index += 1) {
+		Symbol name = (*(AstFunction **)gb_array_get(&lb->unresolved, fun_index))->proto->name;
+		u64 address = LLVMGetFunctionAddress(lb->engine, symbol_cstring(&global_symbols, name));
+		TierFunction *tier_function = lb_tier_function(lb, name);
+		if (tier_function != 0) {
+			gb_atomic_ptr_store(&tier_function->entry, (void *)(uintptr)address);
+		}
+	}
+	gb_array_clear(&lb->unresolved);
+}
+
+static void
+lb_jit_add_definition(LLVMBackend *lb, AstFunction *fun) {
+	LLVMModuleRef module = lb_end_module_optimized(lb);
+	lb_begin_module(lb);
+	lb_jit_add_definition_module(lb, fun, module);
+}
+
+static void
+lb_jit_remove_module(LLVMBackend *lb, LLVMModuleRef module) {
+	LLVMModuleRef removed_module = 0;
+	char *error = 0;
+	if (LLVMRemoveModule(lb->engine, module, &removed_module, &error)) {
+		GB_PANIC("failed to remove module from JIT: %s", error);
+	}
+	LLVMDisposeModule(removed_module);
+}
+
+typedef f64 JitExprProc(void);
+
+typedef struct JitEvalResult {
+	f64 value;
+	f64 compile_seconds;
+	f64 run_seconds;
+} JitEvalResult;
+
+// NOTE(khvorov) Compiles a top-level expression to native code, calls it once
+// and throws the code away
+static JitEvalResult
+lb_jit_eval(LLVMBackend *lb, AstFunction *fun) {
+	JitEvalResult result = { 0 };
+
+	lb_jit_resolve_definitions(lb);
+	JitMemoryMark jit_memory_mark = jit_memory_get_mark(&lb->jit_memory);
+	f64 compile_start = gb_time_now();
+	LLVMValueRef llvm_fun = lb_function(lb, fun);
+
+	// NOTE(khvorov) MCJIT keeps symbols of removed modules around, so every
+	// expression needs a name of its own
+	char *expr_name = gb_bprintf(LB_ANON_EXPR_NAME ".%td", lb->anon_expr_count);
+	lb->anon_expr_count += 1;
+	LLVMSetValueName2(llvm_fun, expr_name, gb_strlen(expr_name));
+
+	LLVMModuleRef expr_module = lb_jit_add_module(lb);
+	JitExprProc *expr_proc = (JitExprProc *)LLVMGetFunctionAddress(lb->engine, expr_name);
+	GB_ASSERT_NOT_NULL(expr_proc);
+	f64 run_start = gb_time_now();
+	result.value = expr_proc();
+	f64 run_end = gb_time_now();
+
+	result.compile_seconds = run_start - compile_start;
+	result.run_seconds = run_end - run_start;
+
+	lb_jit_remove_module(lb, expr_module);
+	jit_memory_pop(&lb->jit_memory, jit_memory_mark);
+	return result;
+}
+
+//
+// SECTION Compile Cache
+//
+
+#define COMPILE_CACHE_MAGIC 0x31454843434C414Bull // NOTE(khvorov) "KALCCHE1"
+
+#define COMPILE_CACHE_PATH_SIZE 1024
+
+static void
+compile_cache_init(CompileCache *cache, char *dir, i32 opt_level, gbAllocator allocator) {
+	gb_zero_item(cache);
+	cache->dir = dir;
+	cache->allocator = allocator;
+	gb_array_init(&cache->hash_stack, allocator, sizeof(AstExpr));
+	gb_random_init(&cache->random);
+
+	// NOTE(khvorov) Failing to create it is fine, it might be there already
+#if defined(GB_SYSTEM_WINDOWS)
+	CreateDirectoryA(dir, 0);
+#else
+	mkdir(dir, 0777);
+#endif
+
+	char *triple = LLVMGetDefaultTargetTriple();
+	u64 magic = COMPILE_CACHE_MAGIC;
+	cache->key_seed = gb_murmur64(&magic, gb_size_of(magic));
+	cache->key_seed = gb_murmur64_seed(&opt_level, gb_size_of(opt_level), cache->key_seed);
+	cache->key_seed = gb_murmur64_seed(triple, gb_strlen(triple), cache->key_seed);
+	LLVMDisposeMessage(triple);
+}
+
+static void
+compile_cache_destroy(CompileCache *cache) {
+	gb_array_free(&cache->hash_stack);
+}
+
+static u64
+compile_cache_hash_symbol(u64 hash, Symbol symbol) {
+	String str = symbol_string(&global_symbols, symbol);
+	u64 result = gb_murmur64_seed(str.ptr, str.len, hash);
+	return result;
+}
+
+// NOTE(khvorov) Symbols are hashed by name since their indices depend on the
+// order the names were first seen in
+static u64
+compile_cache_key(CompileCache *cache, AstPool *ast, AstFunction *fun) {
+	AstPrototype *proto = fun->proto;
+	u64 result = compile_cache_hash_symbol(cache->key_seed, proto->name);
+	result = gb_murmur64_seed(&proto->kind, gb_size_of(proto->kind), result);
+	result = gb_murmur64_seed(&proto->param_count, gb_size_of(proto->param_count), result);
+	for (isize param_index = 0; param_index < proto->param_count; param_index += 1) {
+		result = compile_cache_hash_symbol(result, proto->param[param_index].name);
+	}
+
+	gbDynamicArray *stack = &cache->hash_stack;
+	gb_array_clear(stack);
+	gb_array_append(stack, &fun->body);
+	while (stack->len > 0) {
+		AstExpr expr = *(AstExpr *)gb_array_get(stack, stack->len - 1);
+		gb_array_pop(stack);
+
+		u8 type = (u8)ast_type(expr);
+		result = gb_murmur64_seed(&type, gb_size_of(type), result);
+		switch (ast_type(expr)) {
+		case AstType_None: break;
+
+		case AstType_Number: {
+			AstNumber *number = ast_get(&ast->numbers, expr);
+			result = gb_murmur64_seed(&number->val, gb_size_of(number->val), result);
+		} break;
+
+		case AstType_Variable: {
+			AstVariable *variable = ast_get(&ast->variables, expr);
+			result = compile_cache_hash_symbol(result, variable->name);
+		} break;
+
+		case AstType_Unary: {
+			AstUnary *unary = ast_get(&ast->unaries, expr);
+			result = gb_murmur64_seed(&unary->op, gb_size_of(unary->op), result);
+			gb_array_append(stack, &unary->operand);
+		} break;
+
+		case AstType_Binary: {
+			AstBinary *binary = ast_get(&ast->binaries, expr);
+			result = gb_murmur64_seed(&binary->op, gb_size_of(binary->op), result);
+			gb_array_append(stack, &binary->rhs);
+			gb_array_append(stack, &binary->lhs);
+		} break;
+
+		case AstType_Call: {
+			AstCall *call = ast_get(&ast->calls, expr);
+			result = compile_cache_hash_symbol(result, call->callee);
+			result = gb_murmur64_seed(&call->arg_count, gb_size_of(call->arg_count), result);
+			for (u32 arg_index = call->arg_count; arg_index > 0; arg_index -= 1) {
+				gb_array_append(stack, gb_array_get(&ast->args, call->arg_start + arg_index - 1));
+			}
+		} break;
+
+		case AstType_If: {
+			AstIf *node = ast_get(&ast->ifs, expr);
+			gb_array_append(stack, &node->else_branch);
+			gb_array_append(stack, &node->then_branch);
+			gb_array_append(stack, &node->cond);
+		} break;
+
+		case AstType_For: {
+			AstFor *node = ast_get(&ast->fors, expr);
+			result = compile_cache_hash_symbol(result, node->var);
+			gb_array_append(stack, &node->body);
+			gb_array_append(stack, &node->step);
+			gb_array_append(stack, &node->end);
+			gb_array_append(stack, &node->start);
+		} break;
+
+		case AstType_Var: {
+			AstVar *node = ast_get(&ast->vars, expr);
+			result = gb_murmur64_seed(&node->binding_count, gb_size_of(node->binding_count), result);
+			gb_array_append(stack, &node->body);
+			for (u32 binding_index = node->binding_count; binding_index > 0; binding_index -= 1) {
+				AstVarBinding *binding = gb_array_get(&ast->var_bindings, node->binding_start + binding_index - 1);
+				result = compile_cache_hash_symbol(result, binding->name);
+				gb_array_append(stack, &binding->init);
+			}
+		} break;
+		}
+	}
+
+	return result;
+}
+
+static void
+compile_cache_path(CompileCache *cache, u64 key, char *path) {
+	isize len = gb_snprintf(path, COMPILE_CACHE_PATH_SIZE, "%s/%016llx.bc", cache->dir, (unsigned long long)key);
+	GB_ASSERT_MSG(len > 0 && len < COMPILE_CACHE_PATH_SIZE, "cache directory path is too long");
+}
+
+// NOTE(khvorov) Files are checked before LLVM sees them since LLVM exits on
+// bitcode it cannot read
+static b32
+compile_cache_load(CompileCache *cache, LLVMContextRef ctx, u64 key, LLVMModuleRef *module, f64 *generate_seconds) {
+	char path[COMPILE_CACHE_PATH_SIZE];
+	compile_cache_path(cache, key, path);
+	gbFileContents contents = gb_file_read_contents(cache->allocator, false, path);
+	CompileCacheHeader *header = contents.data;
+	b32 result = false;
+
+	if (contents.data != 0 && contents.size > gb_size_of(CompileCacheHeader)
+		&& header->magic == COMPILE_CACHE_MAGIC && header->key == key
+		&& header->bitcode_size == (u64)(contents.size - gb_size_of(CompileCacheHeader))) {
+		LLVMMemoryBufferRef bitcode = LLVMCreateMemoryBufferWithMemoryRange(
+			(char *)(header + 1), (size_t)header->bitcode_size, path, false
+		);
+		result = !LLVMParseBitcodeInContext2(ctx, bitcode, module);
+		LLVMDisposeMemoryBuffer(bitcode);
+		*generate_seconds = header->generate_seconds;
+	}
+
+	if (contents.data != 0) {
+		gb_file_free_contents(&contents);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Written under a temporary name and moved into place so that
+// other processes never see a partial file. Failing to write is not an error,
+// the definition just gets generated again next time.
+static void
+compile_cache_store(CompileCache *cache, u64 key, LLVMModuleRef module, f64 generate_seconds) {
+	char path[COMPILE_CACHE_PATH_SIZE];
+	char temp_path[COMPILE_CACHE_PATH_SIZE];
+	compile_cache_path(cache, key, path);
+	gb_snprintf(temp_path, gb_size_of(temp_path), "%s.%08x.tmp", path, gb_random_gen_u32(&cache->random));
+
+	LLVMMemoryBufferRef bitcode = LLVMWriteBitcodeToMemoryBuffer(module);
+	CompileCacheHeader header = { 0 };
+	header.magic = COMPILE_CACHE_MAGIC;
+	header.key = key;
+	header.bitcode_size = LLVMGetBufferSize(bitcode);
+	header.generate_seconds = generate_seconds;
+
+	gbFile file = { 0 };
+	if (gb_file_create(&file, temp_path) == gbFileError_None) {
+		b32 written = gb_file_write(&file, &header, gb_size_of(header))
+			&& gb_file_write(&file, LLVMGetBufferStart(bitcode), (isize)header.bitcode_size);
+		gb_file_close(&file);
+		// NOTE(khvorov) Moving does not replace a file that is there already.
+		// That one could not be read or another process has just written it.
+		b32 moved = written && gb_file_move(temp_path, path);
+		if (written && !moved) {
+			gb_file_remove(path);
+			moved = gb_file_move(temp_path, path);
+		}
+		if (!moved) {
+			gb_file_remove(temp_path);
+		}
+	}
+
+	LLVMDisposeMemoryBuffer(bitcode);
+}
+
+static void
+compile_cache_report(CompileCache *cache) {
+	isize lookups = cache->hits + cache->misses;
+	gb_printf(
+		"Cache: %td hits, %td misses (%.1f%% hit rate), saved %.3f ms\n",
+		cache->hits, cache->misses, lookups > 0 ? 100.0 * (f64)cache->hits / (f64)lookups : 0.0,
+		cache->saved_seconds * 1000.0
+	);
+}
+
+// NOTE(khvorov) A hit skips generating and optimizing the definition, the JIT
+// still has to compile the bitcode to machine code
+static void
+lb_jit_define(LLVMBackend *lb, AstFunction *fun, b32 dump_ir) {
+	CompileCache *cache = lb->cache;
+	f64 start = gb_time_now();
+	u64 key = 0;
+	LLVMModuleRef cached_module = 0;
+	f64 generate_seconds = 0;
+	if (cache != 0) {
+		key = compile_cache_key(cache, lb->ast, fun);
+		compile_cache_load(cache, lb->ctx, key, &cached_module, &generate_seconds);
+	}
+
+	if (cached_module != 0) {
+		lb_extern(lb, fun->proto);
+		LLVMDisposeModule(lb_end_module(lb));
+		lb_begin_module(lb);
+		cache->hits += 1;
+		cache->saved_seconds += generate_seconds - (gb_time_now() - start);
+		if (dump_ir) {
+			LLVMDumpModule(cached_module);
+		}
+		lb_jit_add_definition_module(lb, fun, cached_module);
+	} else {
+		lb_function(lb, fun);
+		if (dump_ir) {
+			LLVMDumpModule(lb->module);
+		}
+		if (cache != 0) {
+			LLVMModuleRef module = lb_end_module_optimized(lb);
+			lb_begin_module(lb);
+			compile_cache_store(cache, key, module, gb_time_now() - start);
+			lb_jit_add_definition_module(lb, fun, module);
+			cache->misses += 1;
+		} else {
+			lb_jit_add_definition(lb, fun);
+		}
+	}
+}
+
+//
+// SECTION Tiering
+//
+
+// NOTE(khvorov) Functions start out compiled at the -O level from the command
+// line with a call counter at the top. Once a function gets hot it is
+// generated again from its AST, without the counter, and handed to a
+// background thread that optimizes it at -O3 in an engine of its own and
+// points the function's entry at the result.
+
+static void
+tier_push_job(Tiering *tiering, TierJob job) {
+	gb_mutex_lock(&tiering->mutex);
+	gb_array_append(&tiering->jobs, &job);
+	gb_mutex_unlock(&tiering->mutex);
+	gb_semaphore_release(&tiering->semaphore);
+}
+
+static void
+tier_compile(Tiering *tiering, TierJob *job) {
+	LLVMPassManagerBuilderRef pass_builder = LLVMPassManagerBuilderCreate();
+	LLVMPassManagerBuilderSetOptLevel(pass_builder, 3);
+	LLVMPassManagerRef passes = LLVMCreatePassManager();
+	LLVMPassManagerBuilderPopulateModulePassManager(pass_builder, passes);
+	LLVMPassManagerBuilderDispose(pass_builder);
+	LLVMRunPassManager(passes, job->module);
+	LLVMDisposePassManager(passes);
+
+	struct LLVMMCJITCompilerOptions options;
+	LLVMInitializeMCJITCompilerOptions(&options, sizeof(options));
+	options.OptLevel = 3;
+	LLVMExecutionEngineRef engine = 0;
+	char *error = 0;
+	if (LLVMCreateMCJITCompilerForModule(&engine, job->module, &options, sizeof(options), &error)) {
+		GB_PANIC("failed to create JIT: %s", error);
+	}
+
+	// NOTE(khvorov) The symbol table belongs to the main thread, the name is
+	// taken from the module instead
+	size_t name_len = 0;
+	char const *name = LLVMGetValueName2(job->llvm_function, &name_len);
+	u64 address = LLVMGetFunctionAddress(engine, name);
+	GB_ASSERT(address != 0);
+	gb_atomic_ptr_store(&job->function->entry, (void *)(uintptr)address);
+
+	gb_array_append(&tiering->engines, &engine);
+	gb_array_append(&tiering->contexts, &job->ctx);
+}
+
+static GB_THREAD_PROC(tier_thread_proc) {
+	Tiering *tiering = thread->user_data;
+	b32 running = true;
+	while (running) {
+		gb_semaphore_wait(&tiering->semaphore);
+		gb_mutex_lock(&tiering->mutex);
+		TierJob job = *(TierJob *)gb_array_get(&tiering->jobs, tiering->jobs_head);
+		tiering->jobs_head += 1;
+		gb_mutex_unlock(&tiering->mutex);
+
+		if (job.function == 0) {
+			running = false;
+		} else {
+			f64 start = gb_time_now();
+			tier_compile(tiering, &job);
+			tiering->compile_seconds += gb_time_now() - start;
+		}
+	}
+	return 0;
+}
+
+static void
+tier_init(Tiering *tiering, LLVMBackend *lb, gbAllocator allocator) {
+	gb_zero_item(tiering);
+	gb_semaphore_init(&tiering->semaphore);
+	gb_mutex_init(&tiering->mutex);
+	gb_array_init(&tiering->jobs, allocator, sizeof(TierJob));
+	gb_array_init(&tiering->engines, allocator, sizeof(LLVMExecutionEngineRef));
+	gb_array_init(&tiering->contexts, allocator, sizeof(LLVMContextRef));
+	gb_htab_init(&tiering->functions, allocator, sizeof(Symbol), sizeof(TierFunction *), symbol_hash, symbol_cmp);
+	gb_arena_init_from_allocator(&tiering->arena, allocator, gb_kilobytes(64));
+	tiering->allocator = allocator;
+	tiering->ast = lb->ast;
+	tiering->function_protos = lb->function_protos;
+	tiering->engine = lb->engine;
+	lb->tiering = tiering;
+
+	gb_thread_init(&tiering->thread);
+	gb_thread_start(&tiering->thread, tier_thread_proc, tiering);
+}
+
+// NOTE(khvorov) Called before the function is generated so that it calls
+// itself through its entry too
+static void
+tier_add_function(Tiering *tiering, AstFunction *fun) {
+	TierFunction *function = gb_alloc_item(gb_arena_allocator(&tiering->arena), TierFunction);
+	gb_zero_item(function);
+	function->fun = fun;
+	function->tiering = tiering;
+	gb_htab_set(&tiering->functions, &fun->proto->name, &function);
+}
+
+// NOTE(khvorov) Called from generated code on the main thread when a function
+// gets hot. The main backend is idle while generated code runs, but the
+// optimized version needs a context the background thread can have to itself.
+static void
+tier_up(TierFunction *function) {
+	if (!function->queued) {
+		function->queued = true;
+		Tiering *tiering = function->tiering;
+
+		LLVMBackend lb;
+		lb_init(&lb, LLVMContextCreate(), tiering->allocator);
+		lb.engine = tiering->engine;
+		lb.ast = tiering->ast;
+		lb.function_protos = tiering->function_protos;
+		lb.tiering = tiering;
+		lb.optimizing = function;
+		lb_begin_module(&lb);
+
+		TierJob job = { 0 };
+		job.function = function;
+		job.ctx = lb.ctx;
+		job.llvm_function = lb_function(&lb, function->fun);
+		job.module = lb_end_module(&lb);
+		lb_destroy(&lb);
+
+		tier_push_job(tiering, job);
+	}
+}
+
+// NOTE(khvorov) Waits for the jobs already queued
+static void
+tier_destroy(Tiering *tiering) {
+	TierJob stop = { 0 };
+	tier_push_job(tiering, stop);
+	gb_thread_join(&tiering->thread);
+	gb_thread_destroy(&tiering->thread);
+
+	gb_printf(
+		"Recompiled %td hot functions at -O3 (%.3f ms in the background)\n",
+		tiering->engines.len, tiering->compile_seconds * 1000.0
+	);
+
+	for (isize engine_index = 0; engine_index < tiering->engines.len; engine_index += 1) {
+		LLVMDisposeExecutionEngine(*(LLVMExecutionEngineRef *)gb_array_get(&tiering->engines, engine_index));
+		LLVMContextDispose(*(LLVMContextRef *)gb_array_get(&tiering->contexts, engine_index));
+	}
+
+	gb_semaphore_destroy(&tiering->semaphore);
+	gb_mutex_destroy(&tiering->mutex);
+	gb_array_free(&tiering->jobs);
+	gb_array_free(&tiering->engines);
+	gb_array_free(&tiering->contexts);
+	gb_htab_destroy(&tiering->functions);
+	gb_arena_free(&tiering->arena);
+}
+
+//
+// SECTION Jobs
+//
+
+#if defined(GB_COMPILER_MSVC)
+#define JOB_COMPILER_BARRIER() _ReadWriteBarrier()
+#else
+#define JOB_COMPILER_BARRIER() __asm__ volatile("" : : : "memory")
+#endif
+
+// NOTE(khvorov) Failed rounds of stealing before an idle worker goes to sleep
+#define JOB_IDLE_SPINS 256
+
+gb_global gb_thread_local JobWorker *job_current_worker;
+
+static void
+job_deque_init(JobDeque *deque, gbAllocator allocator) {
+	gb_zero_item(deque);
+	deque->jobs = gb_alloc_array(allocator, Job, JOB_DEQUE_SIZE);
+}
+
+// NOTE(khvorov) Owner only. Returns false when the deque is full.
+static b32
+job_deque_push(JobDeque *deque, Job job) {
+	i64 bottom = gb_atomic64_load(&deque->bottom);
+	i64 top = gb_atomic64_load(&deque->top);
+	b32 result = bottom - top < JOB_DEQUE_SIZE;
+	if (result) {
+		deque->jobs[bottom & (JOB_DEQUE_SIZE - 1)] = job;
+		JOB_COMPILER_BARRIER();
+		gb_atomic64_store(&deque->bottom, bottom + 1);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Owner only. The exchange is a full barrier so that thieves see
+// the new bottom before the top is read back.
+static b32
+job_deque_pop(JobDeque *deque, Job *job) {
+	i64 bottom = gb_atomic64_load(&deque->bottom) - 1;
+	gb_atomic64_exchanged(&deque->bottom, bottom);
+	i64 top = gb_atomic64_load(&deque->top);
+	b32 result = false;
+
+	if (top <= bottom) {
+		*job = deque->jobs[bottom & (JOB_DEQUE_SIZE - 1)];
+		result = true;
+		if (top == bottom) {
+			// NOTE(khvorov) The last job, thieves might be after it too
+			result = gb_atomic64_compare_exchange(&deque->top, top, top + 1) == top;
+			gb_atomic64_store(&deque->bottom, bottom + 1);
+		}
+	} else {
+		gb_atomic64_store(&deque->bottom, bottom + 1);
+	}
+
+	return result;
+}
+
+static b32
+job_deque_steal(JobDeque *deque, Job *job) {
+	i64 top = gb_atomic64_load(&deque->top);
+	gb_mfence();
+	i64 bottom = gb_atomic64_load(&deque->bottom);
+	b32 result = false;
+
+	if (top < bottom) {
+		*job = deque->jobs[top & (JOB_DEQUE_SIZE - 1)];
+		JOB_COMPILER_BARRIER();
+		result = gb_atomic64_compare_exchange(&deque->top, top, top + 1) == top;
+	}
+
+	return result;
+}
+
+static void
+job_run(JobWorker *worker, Job *job) {
+	job->proc(job->data);
+	gb_atomic32_fetch_add(job->counter, -1);
+	worker->jobs_run += 1;
+}
+
+// NOTE(khvorov) Runs a job from the worker's own deque or steals one, starting
+// from a random victim. Returns false if there was nothing to do.
+static b32
+job_worker_run_one(JobWorker *worker) {
+	JobSystem *system = worker->system;
+	Job job = { 0 };
+	b32 result = job_deque_pop(&worker->deque, &job);
+
+	if (!result && system->worker_count > 1) {
+		worker->random = worker->random * 1664525 + 1013904223;
+		isize first_victim = (worker->random >> 16) % system->worker_count;
+		for (isize offset = 0; offset < system->worker_count && !result; offset += 1) {
+			JobWorker *victim = system->workers + (first_victim + offset) % system->worker_count;
+			if (victim != worker) {
+				result = job_deque_steal(&victim->deque, &job);
+			}
+		}
+		if (result) {
+			worker->jobs_stolen += 1;
+		}
+	}
+
+	if (result) {
+		job_run(worker, &job);
+	}
+
+	return result;
+}
+
+// NOTE(khvorov) Pinning is only a hint, a worker that cannot be pinned runs
+// wherever the scheduler puts it
+static void
+job_worker_pin(JobWorker *worker) {
+	gbAffinity *affinity = &worker->system->affinity;
+	worker->pinned = gb_affinity_set(affinity, worker->index % affinity->core_count, 0);
+}
+
+static GB_THREAD_PROC(job_worker_proc) {
+	JobWorker *worker = thread->user_data;
+	JobSystem *system = worker->system;
+	job_current_worker = worker;
+	job_worker_pin(worker);
+
+	isize idle_spins = 0;
+	while (gb_atomic32_load(&system->running)) {
+		if (job_worker_run_one(worker)) {
+			idle_spins = 0;
+		} else if (idle_spins < JOB_IDLE_SPINS) {
+			idle_spins += 1;
+			gb_yield_thread();
+		} else {
+			// NOTE(khvorov) A wake-up can be missed between the check in
+			// job_submit and here. The submitter then runs the job itself
+			// while it waits.
+			gb_atomic32_fetch_add(&system->sleeping, 1);
+			gb_semaphore_wait(&system->wake);
+			gb_atomic32_fetch_add(&system->sleeping, -1);
+			idle_spins = 0;
+		}
+	}
+
+	return 0;
+}
+
+// NOTE(khvorov) The calling thread becomes worker 0 and has to be the one to
+// wait on jobs. Every worker is pinned to a logical processor of its own, out
+// of the ones the calling thread may run on, as far as there are enough of
+// them. The calling thread gets its mask back in job_system_destroy.
+static void
+job_system_init(JobSystem *system, isize worker_count, gbAllocator allocator) {
+	GB_ASSERT(worker_count >= 1);
+	gb_zero_item(system);
+	system->worker_count = worker_count;
+	system->allocator = allocator;
+	gb_affinity_init(&system->affinity);
+	gb_semaphore_init(&system->wake);
+	gb_atomic32_store(&system->running, 1);
+
+	system->workers = gb_alloc_array(allocator, JobWorker, worker_count);
+	for (isize worker_index = 0; worker_index < worker_count; worker_index += 1) {
+		JobWorker *worker = system->workers + worker_index;
+		gb_zero_item(worker);
+		job_deque_init(&worker->deque, allocator);
+		worker->system = system;
+		worker->index = worker_index;
+		worker->random = (u32)worker_index + 1;
+	}
+
+	// NOTE(khvorov) Threads inherit the mask of their creator, so worker 0 is
+	// pinned last for a worker that fails to pin not to end up on its processor
+	job_current_worker = system->workers;
+	for (isize worker_index = 1; worker_index < worker_count; worker_index += 1) {
+		JobWorker *worker = system->workers + worker_index;
+		gb_thread_init(&worker->thread);
+		gb_thread_start(&worker->thread, job_worker_proc, worker);
+	}
+	job_worker_pin(system->workers);
+}
+
+static void
+job_system_destroy(JobSystem *system) {
+	gb_atomic32_store(&system->running, 0);
+	gb_semaphore_post(&system->wake, (i32)system->worker_count);
+	for (isize worker_index = 1; worker_index < system->worker_count; worker_index += 1) {
+		JobWorker *worker = system->workers + worker_index;
+		gb_thread_join(&worker->thread);
+		gb_thread_destroy(&worker->thread);
+	}
+	for (isize worker_index = 0; worker_index < system->worker_count; worker_index += 1) {
+		gb_free(system->allocator, system->workers[worker_index].deque.jobs);
+	}
+	if (system->workers[0].pinned) {
+		b32 reset = gb_affinity_reset(&system->affinity);
+		GB_ASSERT_MSG(reset, "could not restore the affinity of the calling thread");
+	}
+	gb_free(system->allocator, system->workers);
+	gb_semaphore_destroy(&system->wake);
+	gb_affinity_destroy(&system->affinity);
+	job_current_worker = 0;
+}
+
+// NOTE(khvorov) Only threads of the system can submit jobs. When the deque is
+// full the job runs straight away.
+static void
+job_submit(JobSystem *system, JobProc *proc, void *data, gbAtomic32 *counter) {
+	JobWorker *worker = job_current_worker;
+	GB_ASSERT_MSG(worker != 0 && worker->system == system, "jobs can only be submitted from the job system's threads");
+
+	Job job = { proc, data, counter };
+	gb_atomic32_fetch_add(counter, 1);
+	if (job_deque_push(&worker->deque, job)) {
+		if (gb_atomic32_load(&system->sleeping) > 0) {
+			gb_semaphore_release(&system->wake);
+		}
+	} else {
+		job_run(worker, &job);
+	}
+}
+
+// NOTE(khvorov) Runs other jobs until every job counted by the counter is done
+static void
+job_wait(JobSystem *system, gbAtomic32 *counter) {
+	JobWorker *worker = job_current_worker;
+	GB_ASSERT(worker != 0 && worker->system == system);
+	while (gb_atomic32_load(counter) > 0) {
+		if (!job_worker_run_one(worker)) {
+			gb_yield_thread();
+		}
+	}
+}
+
+//
+// SECTION Parallel Lexing
+//
+
+// NOTE(khvorov) Smaller inputs are not worth splitting up
+#define LEX_CHUNK_MIN_SIZE gb_kilobytes(256)
+
+// NOTE(khvorov) Chunks per thread, so that threads that finish early can steal
+#define LEX_CHUNKS_PER_WORKER 4
+
+// NOTE(khvorov) No token contains a line break and a comment always ends at
+// one, so the start of any line is a safe place to split the source
+static isize
+lex_split_point(String source, isize target) {
+	isize result = source.len;
+	if (target < source.len) {
+		String rest = { source.ptr + target, source.len - target };
+		isize newline = string_index_newline(&rest);
+		result = gb_min(target + newline + 1, source.len);
+	}
+	return result;
+}
+
+static void
+lex_chunk_job(void *data) {
+	LexChunk *chunk = data;
+	String input = chunk->input;
+	while (true) {
+		Token token = get_token_with_symbols(&input, &chunk->symbols);
+		if (token.type == TokenType_EOF) {
+			break;
+		}
+		token_stream_append(&chunk->stream, &token);
+	}
+}
+
+// NOTE(khvorov) Same tokens and symbols as token_stream_lex. Each chunk interns
+// into a table of its own, the chunks' symbols are then interned globally one
+// name at a time rather than one token at a time.
+static void
+token_stream_lex_parallel(TokenStream *stream, JobSystem *jobs, gbAllocator allocator) {
+	String source = stream->source;
+	isize chunk_count = gb_min(jobs->worker_count * LEX_CHUNKS_PER_WORKER, source.len / LEX_CHUNK_MIN_SIZE);
+
+	if (chunk_count <= 1) {
+		token_stream_lex(stream);
+	} else {
+		LexChunk *chunks = gb_alloc_array(allocator, LexChunk, chunk_count);
+		gbAtomic32 chunks_left = { 0 };
+		isize chunk_start = 0;
+		for (isize chunk_index = 0; chunk_index < chunk_count; chunk_index += 1) {
+			LexChunk *chunk = chunks + chunk_index;
+			gb_zero_item(chunk);
+			isize chunk_end = source.len;
+			if (chunk_index + 1 < chunk_count) {
+				chunk_end = lex_split_point(source, source.len / chunk_count * (chunk_index + 1));
+			}
+			chunk->input.ptr = source.ptr + chunk_start;
+			chunk->input.len = chunk_end - chunk_start;
+			chunk_start = chunk_end;
+
+			token_stream_init(&chunk->stream, source, allocator);
+			gb_arena_init_from_allocator(&chunk->arena, allocator, SYMBOL_BLOCK_SIZE);
+			symbol_table_init(&chunk->symbols, gb_arena_allocator(&chunk->arena));
+			job_submit(jobs, lex_chunk_job, chunk, &chunks_left);
+		}
+		job_wait(jobs, &chunks_left);
+
+		gbArray(Symbol) global_ids = { 0 };
+		gb_array_init_Symbol(&global_ids, allocator);
+		for (isize chunk_index = 0; chunk_index < chunk_count; chunk_index += 1) {
+			LexChunk *chunk = chunks + chunk_index;
+
+			gb_array_clear_Symbol(&global_ids);
+			for (isize symbol_index = 0; symbol_index < chunk->symbols.names.len; symbol_index += 1) {
+				Symbol global_id = 0;
+				if (symbol_index > 0) {
+					global_id = symbol_intern(&global_symbols, gb_array_get(&chunk->symbols.names, symbol_index));
+				}
+				gb_array_append_Symbol(&global_ids, global_id);
+			}
+
+			isize symbol_start = stream->symbols.len;
+			gb_array_appendv_u8(&stream->kinds, chunk->stream.kinds.ptr, chunk->stream.kinds.len);
+			gb_array_appendv_u32(&stream->offsets, chunk->stream.offsets.ptr, chunk->stream.offsets.len);
+			gb_array_appendv_Symbol(&stream->symbols, chunk->stream.symbols.ptr, chunk->stream.symbols.len);
+			gb_array_appendv_f64(&stream->numbers, chunk->stream.numbers.ptr, chunk->stream.numbers.len);
+			Symbol *symbols = stream->symbols.ptr;
+			for (isize symbol_index = symbol_start; symbol_index < stream->symbols.len; symbol_index += 1) {
+				symbols[symbol_index] = global_ids.ptr[symbols[symbol_index]];
+			}
+
+			token_stream_destroy(&chunk->stream);
+			gb_arena_free(&chunk->arena);
+		}
+		gb_array_free_Symbol(&global_ids);
+		gb_free(allocator, chunks);
+	}
+}
+
+//
+// SECTION Parallel Codegen
+//
+
+// NOTE(khvorov) Workers take this many definitions at a time
+#define CODEGEN_CHUNK_SIZE 16
+
+// NOTE(khvorov) LLVM contexts are not thread-safe, so every worker generates
+// its share of the definitions into a module in a context of its own. The
+// module comes back as bitcode since it cannot be linked across contexts.
+static void
+codegen_worker_job(void *data) {
+	CodegenWorker *worker = data;
+	CodegenBatch *batch = worker->batch;
+
+	LLVMBackend lb;
+	lb_init(&lb, LLVMContextCreate(), worker->allocator);
+	lb.engine = batch->lb->engine;
+	lb.ast = batch->lb->ast;
+	lb.function_protos = batch->lb->function_protos;
+	lb.function_protos_read_only = true;
+	lb.tiering = batch->lb->tiering;
+	lb.opt_level = batch->lb->opt_level;
+	lb_begin_module(&lb);
+
+	b32 more = true;
+	while (more) {
+		isize start = gb_atomic32_fetch_add(&batch->next_function, CODEGEN_CHUNK_SIZE);
+		more = start < batch->function_count;
+		if (more) {
+			isize end = gb_min(start + CODEGEN_CHUNK_SIZE, batch->function_count);
+			for (isize function_index = start; function_index < end; function_index += 1) {
+				lb_function(&lb, batch->functions[function_index]);
+			}
+		}
+	}
+
+	LLVMModuleRef module = lb_end_module(&lb);
+	worker->bitcode = LLVMWriteBitcodeToMemoryBuffer(module);
+	LLVMDisposeModule(module);
+	LLVMContextDispose(lb.ctx);
+	lb_destroy(&lb);
+}
+
+// NOTE(khvorov) One codegen job per thread of the job system. The workers'
+// modules are linked into the current module, which the JIT then compiles in
+// one go.
+static void
+lb_jit_add_definitions_parallel(
+	LLVMBackend *lb, AstFunction **functions, isize function_count, JobSystem *jobs, b32 dump_ir, gbAllocator allocator
+) {
+	CodegenBatch batch = { 0 };
+	batch.lb = lb;
+	batch.functions = functions;
+	batch.function_count = function_count;
+
+	isize worker_count = jobs->worker_count;
+	CodegenWorker *workers = gb_alloc_array(allocator, CodegenWorker, worker_count);
+	gbAtomic32 workers_left = { 0 };
+	for (isize worker_index = 0; worker_index < worker_count; worker_index += 1) {
+		CodegenWorker *worker = workers + worker_index;
+		gb_zero_item(worker);
+		worker->batch = &batch;
+		worker->allocator = allocator;
+		job_submit(jobs, codegen_worker_job, worker, &workers_left);
+	}
+	job_wait(jobs, &workers_left);
+
+	for (isize worker_index = 0; worker_index < worker_count; worker_index += 1) {
+		CodegenWorker *worker = workers + worker_index;
+		LLVMModuleRef module = 0;
+		if (LLVMParseBitcodeInContext2(lb->ctx, worker->bitcode, &module)) {
+			GB_PANIC("failed to read the module of codegen worker %td", worker_index);
+		}
+		LLVMDisposeMemoryBuffer(worker->bitcode);
+		if (LLVMLinkModules2(lb->module, module)) {
+			GB_PANIC("failed to link the module of codegen worker %td", worker_index);
+		}
+	}
+	gb_free(allocator, workers);
+
+	if (dump_ir) {
+		LLVMDumpModule(lb->module);
+	}
+
+	lb_jit_add_module(lb);
+	gb_array_appendv(&lb->unresolved, functions, function_count);
+}
+
+//
+// SECTION Main
+//
+
+typedef struct Options {
+	b32 dump_ir;
+	b32 mmap_input;
+	b32 bench_lex;
+	b32 bench_tokens;
+	b32 bench_float;
+	b32 bench_parse;
+	b32 bench_jobs;
+	b32 bench_htab;
+	b32 bench_hash;
+	b32 lex_first;
+	i32 opt_level;
+	b32 time_passes;
+	b32 tier;
+	isize jobs; // NOTE(khvorov) 0 generates each item as soon as it is parsed
+	char *cache_dir; // NOTE(khvorov) 0 means no cache
+} Options;
+
+// NOTE(khvorov) Best of several runs. Only the first run adds names to
+// global_symbols, the rest time lookups of names already interned.
+static f64
+bench_lex_seconds(String source, GetTokenProc *get_token_proc, isize *token_count) {
+	f64 result = 0;
+	for (isize run_index = 0; run_index < 5; run_index += 1) {
+		String input = source;
+		isize run_token_count = 0;
+		f64 start = gb_time_now();
+		while (get_token_proc(&input).type != TokenType_EOF) {
+			run_token_count += 1;
+		}
+		f64 seconds = gb_time_now() - start;
+		if (run_index == 0 || seconds < result) {
+			result = seconds;
+		}
+		*token_count = run_token_count;
+	}
+	return result;
+}
+
+static b32
+bench_lex_check(String source) {
+	b32 result = true;
+	String reference_input = source;
+	String input = source;
+	while (result) {
+		Token reference_token = get_token_reference(&reference_input);
+		Token token = get_token(&input);
+		result = reference_token.type == token.type
+			&& reference_token.identifier.ptr == token.identifier.ptr
+			&& reference_token.identifier.len == token.identifier.len
+			&& reference_token.symbol == token.symbol
+			&& reference_token.number == token.number
+			&& reference_token.ascii == token.ascii;
+		if (token.type == TokenType_EOF) {
+			break;
+		}
+	}
+	return result;
+}
+
+static void
+bench_lex(char *path, gbAllocator allocator) {
+	gbFileContents contents = gb_file_read_contents(allocator, true, path);
+	String source = { contents.data, contents.size };
+	f64 megabytes = (f64)source.len / (f64)gb_megabytes(1);
+
+	isize reference_token_count = 0;
+	isize token_count = 0;
+	f64 reference_seconds = bench_lex_seconds(source, get_token_reference, &reference_token_count);
+	f64 seconds = bench_lex_seconds(source, get_token, &token_count);
+
+	gb_printf(
+		"%s: %.1f MB, %td tokens, reference %.1f MB/s, table/SIMD %.1f MB/s, tokens %s\n",
+		path, megabytes, token_count, megabytes / reference_seconds, megabytes / seconds,
+		bench_lex_check(source) ? "match" : "DIFFER"
+	);
+
+	if (contents.data != 0) {
+		gb_file_free_contents(&contents);
+	}
+}
+
+// NOTE(khvorov) Stand-in for what the parser does with every token
+static isize
+bench_tokens_scan_array(gbArray(Token) *tokens) {
+	isize result = 0;
+	Token *token = tokens->ptr;
+	for (isize token_index = 0; token_index < tokens->len; token_index += 1) {
+		if (token[token_index].type == TokenType_Ascii) {
+			switch (token[token_index].ascii) {
+			case '<': case '+': case '-': case '*': { result += 1; } break;
+			}
+		}
+	}
+	return result;
+}
+
+static isize
+bench_tokens_scan_stream(TokenStream *stream) {
+	isize result = 0;
+	u8 *kinds = stream->kinds.ptr;
+	u32 *offsets = stream->offsets.ptr;
+	for (isize token_index = 0; token_index < stream->kinds.len; token_index += 1) {
+		if (kinds[token_index] == TokenType_Ascii) {
+			switch (stream->source.ptr[offsets[token_index]]) {
+			case '<': case '+': case '-': case '*': { result += 1; } break;
+			}
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) With a job system, also lexes into a TokenStream in parallel and
+// checks that the tokens come out the same
+static void
+bench_tokens(char *path, JobSystem *jobs, gbAllocator allocator) {
+	gbFileContents contents = gb_file_read_contents(allocator, true, path);
+	String source = { contents.data, contents.size };
+
+	// NOTE(khvorov) Intern everything first so both runs see the same table
+	String warmup_input = source;
+	while (get_token(&warmup_input).type != TokenType_EOF) {}
+
+	f64 array_lex_start = gb_time_now();
+	gbArray(Token) tokens = { 0 };
+	gb_array_init_Token(&tokens, allocator);
+	String input = source;
+	while (true) {
+		Token token = get_token(&input);
+		if (token.type == TokenType_EOF) {
+			break;
+		}
+		gb_array_append_Token(&tokens, token);
+	}
+	f64 array_lex_seconds = gb_time_now() - array_lex_start;
+
+	f64 stream_lex_start = gb_time_now();
+	TokenStream stream = { 0 };
+	token_stream_init(&stream, source, allocator);
+	token_stream_lex(&stream);
+	f64 stream_lex_seconds = gb_time_now() - stream_lex_start;
+
+	f64 array_scan_seconds = 0;
+	f64 stream_scan_seconds = 0;
+	isize array_ops = 0;
+	isize stream_ops = 0;
+	for (isize run_index = 0; run_index < 5; run_index += 1) {
+		f64 array_start = gb_time_now();
+		array_ops = bench_tokens_scan_array(&tokens);
+		f64 array_seconds = gb_time_now() - array_start;
+		f64 stream_start = gb_time_now();
+		stream_ops = bench_tokens_scan_stream(&stream);
+		f64 stream_seconds = gb_time_now() - stream_start;
+		if (run_index == 0 || array_seconds < array_scan_seconds) {
+			array_scan_seconds = array_seconds;
+		}
+		if (run_index == 0 || stream_seconds < stream_scan_seconds) {
+			stream_scan_seconds = stream_seconds;
+		}
+	}
+	GB_ASSERT(array_ops == stream_ops);
+
+	f64 token_count = (f64)tokens.len;
+	isize array_size = tokens.cap * gb_size_of(Token);
+	isize stream_size = token_stream_size(&stream);
+	gb_printf(
+		"%s: %td tokens\n"
+		"  Token array: %.1f MB (%.1f B/token), lex %.1f Mtok/s, scan %.1f Mtok/s\n"
+		"  TokenStream: %.1f MB (%.1f B/token), lex %.1f Mtok/s, scan %.1f Mtok/s\n",
+		path, tokens.len,
+		(f64)array_size / gb_megabytes(1), array_size / token_count,
+		token_count / array_lex_seconds / 1e6, token_count / array_scan_seconds / 1e6,
+		(f64)stream_size / gb_megabytes(1), stream_size / token_count,
+		token_count / stream_lex_seconds / 1e6, token_count / stream_scan_seconds / 1e6
+	);
+
+	if (jobs != 0) {
+		f64 parallel_lex_start = gb_time_now();
+		TokenStream parallel_stream = { 0 };
+		token_stream_init(&parallel_stream, source, allocator);
+		token_stream_lex_parallel(&parallel_stream, jobs, allocator);
+		f64 parallel_lex_seconds = gb_time_now() - parallel_lex_start;
+
+		b32 same = stream.kinds.len == parallel_stream.kinds.len
+			&& stream.symbols.len == parallel_stream.symbols.len
+			&& stream.numbers.len == parallel_stream.numbers.len
+			&& gb_memcompare(stream.kinds.ptr, parallel_stream.kinds.ptr, stream.kinds.len * gb_size_of(u8)) == 0
+			&& gb_memcompare(stream.offsets.ptr, parallel_stream.offsets.ptr, stream.offsets.len * gb_size_of(u32)) == 0
+			&& gb_memcompare(stream.symbols.ptr, parallel_stream.symbols.ptr, stream.symbols.len * gb_size_of(Symbol)) == 0
+			&& gb_memcompare(stream.numbers.ptr, parallel_stream.numbers.ptr, stream.numbers.len * gb_size_of(f64)) == 0;
+		gb_printf(
+			"  TokenStream on %td threads: lex %.1f Mtok/s, %s\n",
+			jobs->worker_count, token_count / parallel_lex_seconds / 1e6, same ? "match" : "DIFFER"
+		);
+		token_stream_destroy(&parallel_stream);
+	}
+
+	token_stream_destroy(&stream);
+	gb_array_free_Token(&tokens);
+	if (contents.data != 0) {
+		gb_file_free_contents(&contents);
+	}
+}
+
+// NOTE(khvorov) Keeps the parsed values alive
+static volatile f64 bench_float_sink;
+
+// NOTE(khvorov) What get_token used to do
+static f64
+bench_float_strtod(String str) {
+	char buffer[64];
+	isize len = gb_min(str.len, gb_count_of(buffer) - 1);
+	gb_memcopy(buffer, str.ptr, len);
+	buffer[len] = '\0';
+	f64 result = strtod(buffer, 0);
+	return result;
+}
+
+static void
+bench_float(char *path, gbAllocator allocator) {
+	gbFileContents contents = gb_file_read_contents(allocator, true, path);
+	String source = { contents.data, contents.size };
+
+	gbDynamicArray numbers = { 0 };
+	gb_array_init(&numbers, allocator, sizeof(String));
+	String input = source;
+	isize digit_count = 0;
+	while (true) {
+		Token token = get_token(&input);
+		if (token.type == TokenType_EOF) {
+			break;
+		}
+		if (token.type == TokenType_Number) {
+			gb_array_append(&numbers, &token.identifier);
+			digit_count += token.identifier.len;
+		}
+	}
+	String *number = numbers.ptr;
+
+	// NOTE(khvorov) Exact reference is strtod on the whole literal
+	isize mismatch_count = 0;
+	gbDynamicArray exact_buffer = { 0 };
+	gb_array_init(&exact_buffer, allocator, sizeof(char));
+	for (isize number_index = 0; number_index < numbers.len; number_index += 1) {
+		gb_array_clear(&exact_buffer);
+		for (isize char_index = 0; char_index < number[number_index].len; char_index += 1) {
+			gb_array_append(&exact_buffer, number[number_index].ptr + char_index);
+		}
+		char terminator = '\0';
+		gb_array_append(&exact_buffer, &terminator);
+		f64 exact = strtod(exact_buffer.ptr, 0);
+		f64 parsed = string_to_f64(number[number_index]);
+		if (gb_memcompare(&exact, &parsed, sizeof(f64)) != 0) {
+			if (mismatch_count < 5) {
+				gb_printf_err("mismatch: %.*s -> %.17g, expected %.17g\n", (int)number[number_index].len, number[number_index].ptr, parsed, exact);
+			}
+			mismatch_count += 1;
+		}
+	}
+	gb_array_free(&exact_buffer);
+
+	f64 strtod_seconds = 0;
+	f64 fast_seconds = 0;
+	f64 strtod_sum = 0;
+	f64 fast_sum = 0;
+	for (isize run_index = 0; run_index < 5; run_index += 1) {
+		f64 strtod_start = gb_time_now();
+		strtod_sum = 0;
+		for (isize number_index = 0; number_index < numbers.len; number_index += 1) {
+			strtod_sum += bench_float_strtod(number[number_index]);
+		}
+		f64 strtod_run_seconds = gb_time_now() - strtod_start;
+
+		f64 fast_start = gb_time_now();
+		fast_sum = 0;
+		for (isize number_index = 0; number_index < numbers.len; number_index += 1) {
+			fast_sum += string_to_f64(number[number_index]);
+		}
+		f64 fast_run_seconds = gb_time_now() - fast_start;
+
+		bench_float_sink = strtod_sum + fast_sum;
+		if (run_index == 0 || strtod_run_seconds < strtod_seconds) {
+			strtod_seconds = strtod_run_seconds;
+		}
+		if (run_index == 0 || fast_run_seconds < fast_seconds) {
+			fast_seconds = fast_run_seconds;
+		}
+	}
+
+	f64 count = (f64)numbers.len;
+	f64 megabytes = (f64)digit_count / (f64)gb_megabytes(1);
+	gb_printf(
+		"%s: %td numbers, strtod %.1f Mnum/s (%.1f MB/s), string_to_f64 %.1f Mnum/s (%.1f MB/s), %td mismatches\n",
+		path, numbers.len,
+		count / strtod_seconds / 1e6, megabytes / strtod_seconds,
+		count / fast_seconds / 1e6, megabytes / fast_seconds,
+		mismatch_count
+	);
+
+	gb_array_free(&numbers);
+	if (contents.data != 0) {
+		gb_file_free_contents(&contents);
+	}
+}
+
+typedef enum BenchParseShape {
+	BenchParseShape_Sum, // NOTE(khvorov) 1+1+...+1
+	BenchParseShape_RightNested, // NOTE(khvorov) 1+(1+(...))
+	BenchParseShape_Parens, // NOTE(khvorov) ((((1))))
+	BenchParseShape_Calls, // NOTE(khvorov) f(f(f(1)))
+	BenchParseShape_Count,
+} BenchParseShape;
+
+static char *BENCH_PARSE_SHAPE_NAMES[BenchParseShape_Count] = { "sum", "right-nested", "parens", "calls" };
+
+typedef struct BenchParseRun {
+	String source;
+	gbAllocator allocator;
+	f64 seconds;
+	isize node_count;
+	isize frame_stack_size;
+} BenchParseRun;
+
+static String
+bench_parse_source(BenchParseShape shape, isize term_count, gbAllocator allocator) {
+	gbDynamicArray source = { 0 };
+	gb_array_init_reserve(&source, allocator, sizeof(char), term_count * 6 + 2);
+	char *open = "";
+	char *middle = "";
+	char *close = "";
+	switch (shape) {
+	case BenchParseShape_Sum: { middle = "1+"; } break;
+	case BenchParseShape_RightNested: { open = "1+("; close = ")"; } break;
+	case BenchParseShape_Parens: { open = "("; close = ")"; } break;
+	case BenchParseShape_Calls: { open = "f("; close = ")"; } break;
+	}
+	for (isize term_index = 0; term_index < term_count; term_index += 1) {
+		gb_array_appendv(&source, open, gb_strlen(open));
+		gb_array_appendv(&source, middle, gb_strlen(middle));
+	}
+	gb_array_appendv(&source, "1", 1);
+	for (isize term_index = 0; term_index < term_count; term_index += 1) {
+		gb_array_appendv(&source, close, gb_strlen(close));
+	}
+	gb_array_appendv(&source, "\n", 1);
+	String result = { source.ptr, source.len };
+	return result;
+}
+
+static GB_THREAD_PROC(bench_parse_thread) {
+	BenchParseRun *run = thread->user_data;
+	AstParser parser = { 0 };
+	parser_init(&parser, run->allocator);
+	Lexer lexer = { 0 };
+	lexer.input = run->source;
+
+	f64 start = gb_time_now();
+	parser_set_lexer(&parser, &lexer);
+	parse_expr(&parser);
+	run->seconds = gb_time_now() - start;
+
+	GB_ASSERT(parser.token->type == TokenType_EOF);
+	run->node_count = ast_pool_node_count(&parser.ast);
+	run->frame_stack_size = parser.frames.cap * parser.frames.element_size;
+	parser_destroy(&parser);
+	return 0;
+}
+
+// NOTE(khvorov) Parses pathological expressions on a thread with a small
+// stack. Time per term should stay flat as the input grows.
+static void
+bench_parse(gbAllocator allocator) {
+	isize const stack_size = gb_kilobytes(64);
+	isize const term_counts[] = { 10000, 100000, 1000000 };
+	gb_printf("parsing on a %td KB stack\n", stack_size / gb_kilobytes(1));
+	for (isize shape = 0; shape < BenchParseShape_Count; shape += 1) {
+		for (isize count_index = 0; count_index < gb_count_of(term_counts); count_index += 1) {
+			BenchParseRun run = { 0 };
+			run.source = bench_parse_source((BenchParseShape)shape, term_counts[count_index], allocator);
+			run.allocator = allocator;
+
+			gbThread thread = { 0 };
+			gb_thread_init(&thread);
+			gb_thread_start_with_stack(&thread, bench_parse_thread, &run, stack_size);
+			gb_thread_join(&thread);
+			gb_thread_destroy(&thread);
+
+			gb_printf(
+				"  %s, %td terms: %.2f ms, %.1f ns/term, %td nodes, frame stack %td KB\n",
+				BENCH_PARSE_SHAPE_NAMES[shape], term_counts[count_index], run.seconds * 1000.0,
+				run.seconds * 1e9 / (f64)term_counts[count_index], run.node_count,
+				run.frame_stack_size / gb_kilobytes(1)
+			);
+			gb_free(allocator, run.source.ptr);
+		}
+	}
+}
+
+// NOTE(khvorov) Seconds per operation
+typedef struct BenchHtabTimes {
+	f64 insert;
+	f64 hit;
+	f64 miss;
+	f64 clear;
+} BenchHtabTimes;
+
+// NOTE(khvorov) Keeps the lookups from being optimized out
+static volatile isize bench_htab_sink;
+
+// NOTE(khvorov) The first count keys go in, the other count are the misses.
+// The values are stand-ins for the stack slots named_values keeps. Each phase
+// is timed across all the repeats so that small tables are not all timer.
+// Every table gets the same harness and provides bench_htab_<name>_init,
+// _destroy, _clear, _set and _get. Those are called directly, so the typed
+// tables still inline.
+#define BENCH_HTAB_DEFINE(name, Table) \
+static BenchHtabTimes \
+bench_htab_##name(Symbol *keys, isize count, isize repeats, gbAllocator allocator) { \
+	BenchHtabTimes result = { 0 }; \
+	Table htab = { 0 }; \
+	bench_htab_##name##_init(&htab, allocator); \
+	isize found = 0; \
+\
+	f64 start = gb_time_now(); \
+	for (isize repeat = 0; repeat < repeats; repeat += 1) { \
+		bench_htab_##name##_clear(&htab); \
+		for (isize key_index = 0; key_index < count; key_index += 1) { \
+			bench_htab_##name##_set(&htab, keys[key_index], (LLVMValueRef)(uintptr)keys[key_index]); \
+		} \
+	} \
+	f64 inserted = gb_time_now(); \
+	for (isize repeat = 0; repeat < repeats; repeat += 1) { \
+		for (isize key_index = 0; key_index < count; key_index += 1) { \
+			found += bench_htab_##name##_get(&htab, keys[key_index]); \
+		} \
+	} \
+	f64 hit = gb_time_now(); \
+	for (isize repeat = 0; repeat < repeats; repeat += 1) { \
+		for (isize key_index = count; key_index < 2 * count; key_index += 1) { \
+			found += bench_htab_##name##_get(&htab, keys[key_index]); \
+		} \
+	} \
+	f64 missed = gb_time_now(); \
+	for (isize repeat = 0; repeat < repeats; repeat += 1) { \
+		bench_htab_##name##_clear(&htab); \
+	} \
+	f64 cleared = gb_time_now(); \
+\
+	result.clear = cleared - missed; \
+	result.insert = inserted - start - result.clear; \
+	result.hit = hit - inserted; \
+	result.miss = missed - hit; \
+	GB_ASSERT(found == count * repeats); \
+	bench_htab_sink = found; \
+	bench_htab_##name##_destroy(&htab); \
+	return result; \
+}
+
+static void
+bench_htab_chained_init(gbHashTable *htab, gbAllocator allocator) {
+	gb_htab_init(htab, allocator, sizeof(Symbol), sizeof(LLVMValueRef), symbol_hash, symbol_cmp);
+}
+
+static void
+bench_htab_chained_set(gbHashTable *htab, Symbol key, LLVMValueRef value) {
+	gb_htab_set(htab, &key, &value);
+}
+
+static b32
+bench_htab_chained_get(gbHashTable *htab, Symbol key) {
+	b32 result = gb_htab_get(htab, &key) != 0;
+	return result;
+}
+
+#define bench_htab_chained_clear gb_htab_clear
+#define bench_htab_chained_destroy gb_htab_destroy
+BENCH_HTAB_DEFINE(chained, gbHashTable)
+
+static void
+bench_htab_flat_init(gbFlatHashTable *htab, gbAllocator allocator) {
+	gb_flat_htab_init(htab, allocator, sizeof(Symbol), sizeof(LLVMValueRef), 0, 0);
+}
+
+static void
+bench_htab_flat_set(gbFlatHashTable *htab, Symbol key, LLVMValueRef value) {
+	gb_flat_htab_set(htab, &key, &value);
+}
+
+static b32
+bench_htab_flat_get(gbFlatHashTable *htab, Symbol key) {
+	b32 result = gb_flat_htab_get(htab, &key) != 0;
+	return result;
+}
+
+#define bench_htab_flat_clear gb_flat_htab_clear
+#define bench_htab_flat_destroy gb_flat_htab_destroy
+BENCH_HTAB_DEFINE(flat, gbFlatHashTable)
+
+static b32
+bench_htab_typed_get(gbHtab(Symbol, LLVMValueRef) *htab, Symbol key) {
+	b32 result = gb_htab_get_Symbol_LLVMValueRef(htab, key) != 0;
+	return result;
+}
+
+#define bench_htab_typed_init gb_htab_init_Symbol_LLVMValueRef
+#define bench_htab_typed_set gb_htab_set_Symbol_LLVMValueRef
+#define bench_htab_typed_clear gb_htab_clear_Symbol_LLVMValueRef
+#define bench_htab_typed_destroy gb_htab_destroy_Symbol_LLVMValueRef
+BENCH_HTAB_DEFINE(typed, gbHtab_Symbol_LLVMValueRef)
+
+static b32
+bench_htab_scoped_get(ScopeTable *table, Symbol key) {
+	b32 result = scope_lookup(table, key) != 0;
+	return result;
+}
+
+#define bench_htab_scoped_init scope_table_init
+#define bench_htab_scoped_set scope_bind
+#define bench_htab_scoped_clear scope_table_reset
+#define bench_htab_scoped_destroy scope_table_destroy
+BENCH_HTAB_DEFINE(scoped, ScopeTable)
+
+static void
+bench_htab_print(char *name, BenchHtabTimes times, isize count, isize repeats) {
+	f64 ops = (f64)(count * repeats);
+	gb_printf(
+		"  %s: insert %.1f ns, hit %.1f ns, miss %.1f ns, clear %.1f us\n",
+		name, times.insert * 1e9 / ops, times.hit * 1e9 / ops, times.miss * 1e9 / ops,
+		times.clear * 1e6 / (f64)repeats
+	);
+}
+
+// NOTE(khvorov) Worst single intern into a symbol table that grows to count
+// names, the rest of the table's growth is spread over the other interns
+static void
+bench_htab_growth(isize count, b32 incremental, gbAllocator allocator) {
+	gbArena arena;
+	gb_arena_init_from_allocator(&arena, allocator, SYMBOL_BLOCK_SIZE);
+	SymbolTable table;
+	symbol_table_init(&table, gb_arena_allocator(&arena));
+	table.ids.incremental_rehash = incremental;
+
+	f64 worst_seconds = 0;
+	f64 start = gb_time_now();
+	for (isize name_index = 0; name_index < count; name_index += 1) {
+		char name_buffer[32];
+		String name = { name_buffer, gb_snprintf(name_buffer, gb_size_of(name_buffer), "name%td", name_index) - 1 };
+		f64 intern_start = gb_time_now();
+		symbol_intern(&table, &name);
+		worst_seconds = gb_max(worst_seconds, gb_time_now() - intern_start);
+	}
+	f64 total_seconds = gb_time_now() - start;
+
+	gb_printf(
+		"  %s rehash: %.1f ns/intern including the timer, worst %.3f ms\n",
+		incremental ? "incremental" : "one-shot", total_seconds * 1e9 / (f64)count, worst_seconds * 1000.0
+	);
+	gb_arena_free(&arena);
+}
+
+// NOTE(khvorov) Tables are cleared and filled again the way named_values is
+// for every function, so only the first fill of each size pays for growing
+static void
+bench_htab(gbAllocator allocator) {
+	isize const counts[] = { 10, 1000, 100000, 10000000 };
+	isize const ops_per_count = 10000000;
+	for (isize count_index = 0; count_index < gb_count_of(counts); count_index += 1) {
+		isize count = counts[count_index];
+		isize repeats = gb_max(ops_per_count / count, 1);
+		gb_printf("%td entries, %td repeats\n", count, repeats);
+
+		// NOTE(khvorov) In order, keys that were interned one after the other
+		// would sit next to each other in the chained table
+		Symbol *keys = gb_alloc_array(allocator, Symbol, 2 * count);
+		for (isize key_index = 0; key_index < 2 * count; key_index += 1) {
+			keys[key_index] = (Symbol)key_index + 1;
+		}
+		gb_shuffle(keys, 2 * count, gb_size_of(Symbol));
+
+		bench_htab_print("chained", bench_htab_chained(keys, count, repeats, allocator), count, repeats);
+		bench_htab_print("flat", bench_htab_flat(keys, count, repeats, allocator), count, repeats);
+		bench_htab_print("typed", bench_htab_typed(keys, count, repeats, allocator), count, repeats);
+		bench_htab_print("scoped", bench_htab_scoped(keys, count, repeats, allocator), count, repeats);
+		gb_free(allocator, keys);
+	}
+
+	isize const growth_count = 10000000;
+	gb_printf("interning %td names\n", growth_count);
+	bench_htab_growth(growth_count, false, allocator);
+	bench_htab_growth(growth_count, true, allocator);
+}
+
+typedef u64 BenchHashProc(void const *data, isize len);
+
+typedef struct BenchHash {
+	char *name;
+	BenchHashProc *proc;
+} BenchHash;
+
+// NOTE(khvorov) Keeps the hashes alive
+static volatile u64 bench_hash_sink;
+
+// NOTE(khvorov) Best of several runs, key i starts at keys + i * stride
+static f64
+bench_hash_seconds(BenchHashProc *proc, char *keys, isize stride, isize *lens, isize count, isize repeats) {
+	f64 result = 0;
+	for (isize run_index = 0; run_index < 3; run_index += 1) {
+		u64 hash = 0;
+		f64 start = gb_time_now();
+		for (isize repeat = 0; repeat < repeats; repeat += 1) {
+			for (isize key_index = 0; key_index < count; key_index += 1) {
+				hash ^= proc(keys + key_index * stride, lens[key_index]);
+			}
+		}
+		f64 seconds = gb_time_now() - start;
+		if (run_index == 0 || seconds < result) {
+			result = seconds;
+		}
+		bench_hash_sink = hash;
+	}
+	return result;
+}
+
+static f64
+bench_hash_pow(f64 base, isize exponent) {
+	f64 result = 1;
+	while (exponent > 0) {
+		if (exponent & 1) {
+			result *= base;
+		}
+		base *= base;
+		exponent >>= 1;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Identifiers the way programs name things: every short
+// lowercase name, then names with counters on the end
+static isize
+bench_hash_identifiers(String *names, char *text) {
+	isize result = 0;
+	isize text_len = 0;
+	for (isize len = 1; len <= 4; len += 1) {
+		isize name_count = 1;
+		for (isize char_index = 0; char_index < len; char_index += 1) {
+			name_count *= 26;
+		}
+		for (isize name_index = 0; name_index < name_count; name_index += 1) {
+			isize rest = name_index;
+			names[result].ptr = text + text_len;
+			names[result].len = len;
+			for (isize char_index = 0; char_index < len; char_index += 1) {
+				text[text_len++] = (char)('a' + rest % 26);
+				rest /= 26;
+			}
+			result += 1;
+		}
+	}
+	char *prefixes[] = { "x", "tmp", "loop_index_" };
+	for (isize prefix_index = 0; prefix_index < gb_count_of(prefixes); prefix_index += 1) {
+		for (isize counter = 0; counter < 1000000; counter += 1) {
+			names[result].ptr = text + text_len;
+			names[result].len = gb_snprintf(text + text_len, 32, "%s%td", prefixes[prefix_index], counter) - 1;
+			text_len += names[result].len;
+			result += 1;
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) Counts full 64-bit collisions, how many buckets of a table
+// about as big as the key count get used against what a random hash would
+// fill, and how evenly the 7 bits that become flat table control bytes spread
+static void
+bench_hash_quality(BenchHash *hash, String *names, isize name_count, gbAllocator allocator) {
+	u64 *hashes = gb_alloc_array(allocator, u64, name_count);
+	u64 *temp = gb_alloc_array(allocator, u64, name_count);
+	for (isize name_index = 0; name_index < name_count; name_index += 1) {
+		hashes[name_index] = hash->proc(names[name_index].ptr, names[name_index].len);
+	}
+
+	isize bucket_count = 1;
+	while (bucket_count < name_count) {
+		bucket_count *= 2;
+	}
+	u8 *buckets = gb_alloc(allocator, bucket_count);
+	gb_zero_size(buckets, bucket_count);
+	isize control_counts[128] = { 0 };
+	isize buckets_used = 0;
+	for (isize name_index = 0; name_index < name_count; name_index += 1) {
+		u64 bucket = hashes[name_index] & (u64)(bucket_count - 1);
+		buckets_used += buckets[bucket] == 0;
+		buckets[bucket] = 1;
+		control_counts[hashes[name_index] >> 57] += 1;
+	}
+	f64 random_used = (f64)bucket_count * (1 - bench_hash_pow(1 - 1 / (f64)bucket_count, name_count));
+	f64 control_expected = (f64)name_count / 128;
+	f64 chi_squared = 0;
+	for (isize control = 0; control < 128; control += 1) {
+		f64 difference = (f64)control_counts[control] - control_expected;
+		chi_squared += difference * difference / control_expected;
+	}
+
+	gb_radix_sort(u64)(hashes, temp, name_count);
+	isize collisions = 0;
+	for (isize name_index = 1; name_index < name_count; name_index += 1) {
+		collisions += hashes[name_index] == hashes[name_index - 1];
+	}
+
+	gb_printf(
+		"  %s: %td collisions, %td/%td buckets used (random %.0f), control byte chi-squared %.1f (127 expected)\n",
+		hash->name, collisions, buckets_used, bucket_count, random_used, chi_squared
+	);
+	gb_free(allocator, buckets);
+	gb_free(allocator, temp);
+	gb_free(allocator, hashes);
+}
+
+// NOTE(khvorov) The published wyhash test vectors use the index as the seed.
+// The 48 and 96 byte digit strings come from the reference code and catch
+// the block loop taking a block that should have been left for the tail.
+static b32
+bench_hash_known_answers(void) {
+	char *messages[] = {
+		"", "a", "abc", "message digest", "abcdefghijklmnopqrstuvwxyz",
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+		"12345678901234567890123456789012345678901234567890123456789012345678901234567890",
+	};
+	u64 const expected[] = {
+		0x93228a4de0eec5a2ull, 0xc5bac3db178713c4ull, 0xa97f2f7b1d9b3314ull, 0x786d1f1df3801df4ull,
+		0xdca5a8138ad37c87ull, 0xb9e734f117cfaf70ull, 0x6cc5eab49a92d617ull,
+	};
+	b32 result = true;
+	for (isize message_index = 0; message_index < gb_count_of(messages); message_index += 1) {
+		char *message = messages[message_index];
+		result = result && gb_wyhash64_seed(message, gb_strlen(message), (u64)message_index) == expected[message_index];
+	}
+
+	char digits[96];
+	for (isize digit_index = 0; digit_index < gb_count_of(digits); digit_index += 1) {
+		digits[digit_index] = "1234567890"[digit_index % 10];
+	}
+	result = result && gb_wyhash64(digits, 48) == 0x5415d932c2a5c457ull;
+	result = result && gb_wyhash64(digits, 96) == 0x38ed13b4e05d232eull;
+	return result;
+}
+
+static void
+bench_hash(gbAllocator allocator) {
+	gb_printf("wyhash64 known answers: %s\n", bench_hash_known_answers() ? "match" : "DIFFER");
+
+	BenchHash hashes[] = {
+		{ "murmur64", gb_murmur64 },
+		{ "fnv64a", gb_fnv64a },
+		{ "wyhash64", gb_wyhash64 },
+	};
+
+	// NOTE(khvorov) 0 is keys of every length from 1 to 16 mixed together, the
+	// way identifiers come, so branches on the length stop being predictable
+	isize const lens[] = { 1, 3, 4, 7, 8, 12, 16, 24, 32, 64, 0 };
+	isize const count = 4096;
+	isize const repeats = 20000000 / count;
+	gbRandom random;
+	gb_random_init(&random);
+	char *alphabet = "abcdefghijklmnopqrstuvwxyz0123456789_";
+	isize *key_lens = gb_alloc_array(allocator, isize, count);
+	gb_printf("ns/hash over %td keys\n", count);
+	for (isize len_index = 0; len_index < gb_count_of(lens); len_index += 1) {
+		isize stride = lens[len_index] > 0 ? lens[len_index] : 16;
+		for (isize key_index = 0; key_index < count; key_index += 1) {
+			key_lens[key_index] = lens[len_index] > 0 ? stride : 1 + (isize)(gb_random_gen_u64(&random) % 16);
+		}
+		char *keys = gb_alloc(allocator, stride * count);
+		for (isize char_index = 0; char_index < stride * count; char_index += 1) {
+			keys[char_index] = alphabet[gb_random_gen_u64(&random) % 37];
+		}
+		if (lens[len_index] > 0) {
+			gb_printf("  %td bytes:", lens[len_index]);
+		} else {
+			gb_printf("  1-16 bytes:");
+		}
+		for (isize hash_index = 0; hash_index < gb_count_of(hashes); hash_index += 1) {
+			f64 seconds = bench_hash_seconds(hashes[hash_index].proc, keys, stride, key_lens, count, repeats);
+			gb_printf(" %s %.2f", hashes[hash_index].name, seconds * 1e9 / (f64)(repeats * count));
+		}
+		gb_printf("\n");
+		gb_free(allocator, keys);
+	}
+	gb_free(allocator, key_lens);
+
+	isize const name_capacity = 3500000;
+	String *names = gb_alloc_array(allocator, String, name_capacity);
+	char *text = gb_alloc(allocator, name_capacity * 24);
+	isize name_count = bench_hash_identifiers(names, text);
+	GB_ASSERT(name_count <= name_capacity);
+	gb_printf("%td identifiers\n", name_count);
+	for (isize hash_index = 0; hash_index < gb_count_of(hashes); hash_index += 1) {
+		bench_hash_quality(hashes + hash_index, names, name_count, allocator);
+	}
+	gb_free(allocator, text);
+	gb_free(allocator, names);
+}
+
+typedef struct BenchJobsNode {
+	JobSystem *system;
+	isize depth;
+} BenchJobsNode;
+
+static void
+bench_jobs_empty(void *data) {
+	gb_unused(data);
+}
+
+// NOTE(khvorov) Every node forks two children and waits on them, so most of
+// the leaves end up stolen by the other workers
+static void
+bench_jobs_fork(void *data) {
+	BenchJobsNode *node = data;
+	if (node->depth > 0) {
+		BenchJobsNode children[2] = { { node->system, node->depth - 1 }, { node->system, node->depth - 1 } };
+		gbAtomic32 children_left = { 0 };
+		job_submit(node->system, bench_jobs_fork, children, &children_left);
+		job_submit(node->system, bench_jobs_fork, children + 1, &children_left);
+		job_wait(node->system, &children_left);
+	}
+}
+
+static void
+bench_jobs_print(char *name, JobSystem *system, isize job_count, f64 seconds) {
+	isize jobs_run = 0;
+	isize jobs_stolen = 0;
+	for (isize worker_index = 0; worker_index < system->worker_count; worker_index += 1) {
+		JobWorker *worker = system->workers + worker_index;
+		jobs_run += worker->jobs_run;
+		jobs_stolen += worker->jobs_stolen;
+		worker->jobs_run = 0;
+		worker->jobs_stolen = 0;
+	}
+	gb_printf(
+		"  %s, %td jobs: %.2f ms, %.1f ns/job, %td run, %td stolen\n",
+		name, job_count, seconds * 1000.0, seconds * 1e9 / (f64)job_count, jobs_run, jobs_stolen
+	);
+}
+
+// NOTE(khvorov) Cost of the job system itself, the jobs do no work
+static void
+bench_jobs(isize worker_count, gbAllocator allocator) {
+	isize const batch_count = 1024;
+	isize const batch_size = 1024;
+	isize const fork_depth = 20;
+
+	JobSystem system;
+	job_system_init(&system, worker_count, allocator);
+	gb_printf("%td job threads on %td logical processors\n", worker_count, system.affinity.core_count);
+	if (!system.workers[0].pinned) {
+		gb_printf("could not pin the job threads\n");
+	}
+
+	f64 seconds_start = gb_time_now();
+	for (isize batch_index = 0; batch_index < batch_count; batch_index += 1) {
+		gbAtomic32 jobs_left = { 0 };
+		for (isize job_index = 0; job_index < batch_size; job_index += 1) {
+			job_submit(&system, bench_jobs_empty, 0, &jobs_left);
+		}
+		job_wait(&system, &jobs_left);
+	}
+	bench_jobs_print("flat", &system, batch_count * batch_size, gb_time_now() - seconds_start);
+
+	BenchJobsNode root = { &system, fork_depth };
+	gbAtomic32 root_left = { 0 };
+	seconds_start = gb_time_now();
+	job_submit(&system, bench_jobs_fork, &root, &root_left);
+	job_wait(&system, &root_left);
+	bench_jobs_print("fork tree", &system, ((isize)2 << fork_depth) - 1, gb_time_now() - seconds_start);
+
+	job_system_destroy(&system);
+}
+
+static void
+run_expression(LLVMBackend *lb, AstFunction *fun) {
+	JitEvalResult eval = lb_jit_eval(lb, fun);
+	char value_text[F64_TEXT_SIZE];
+	gb_printf(
+		"Evaluated to %s (compile %.3f ms, run %.3f us)\n",
+		f64_text(value_text, eval.value), eval.compile_seconds * 1000.0, eval.run_seconds * 1000000.0
+	);
+}
+
+static void
+run_top_level_items(LLVMBackend *lb, AstParser *parser, Options *options) {
+	while (parser->token->type != TokenType_EOF) {
+		switch (parser->token->type) {
+		case TokenType_Def: {
+			AstFunction *fun = parse_definition(parser);
+			if (lb->tiering != 0) {
+				tier_add_function(lb->tiering, fun);
+			}
+			lb_jit_define(lb, fun, options->dump_ir);
+		} break;
+
+		case TokenType_Extern: {
+			AstPrototype *proto = parse_extern(parser);
+			lb_extern(lb, proto);
+		} break;
+
+		default: {
+			if (parser->token->type == TokenType_Ascii && parser->token->ascii == ';') {
+				parser_advance(parser);
+			} else {
+				// NOTE(khvorov) Expressions are thrown away after being run
+				gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&parser->arena);
+				AstPoolMark ast_mark = ast_pool_mark(&parser->ast);
+				AstFunction *fun = parse_top_level_expr(parser);
+				run_expression(lb, fun);
+				ast_pool_reset(&parser->ast, ast_mark);
+				gb_temp_arena_memory_end(temp_memory);
+			}
+		} break;
+		}
+	}
+}
+
+// NOTE(khvorov) Definitions are collected until the next expression, generated
+// in parallel and then the expression runs. Output comes in the same order and
+// at the same points as with run_top_level_items.
+static void
+run_top_level_items_parallel(LLVMBackend *lb, AstParser *parser, JobSystem *jobs, Options *options, gbAllocator allocator) {
+	gbDynamicArray definitions = { 0 };
+	gb_array_init(&definitions, allocator, sizeof(AstFunction *));
+
+	while (parser->token->type != TokenType_EOF) {
+		switch (parser->token->type) {
+		case TokenType_Def: {
+			// NOTE(khvorov) Running them one by one, the JIT keeps the first
+			// definition of a name. Two in one batch would not link.
+			AstFunction *fun = parse_definition(parser);
+			AstPrototype **known_proto = gb_htab_get(lb->function_protos, &fun->proto->name);
+			if (known_proto == 0 || !(*known_proto)->has_body) {
+				if (lb->tiering != 0) {
+					tier_add_function(lb->tiering, fun);
+				}
+				// NOTE(khvorov) The workers need every prototype up front
+				lb_extern(lb, fun->proto);
+				gb_array_append(&definitions, &fun);
+			}
+		} break;
+
+		case TokenType_Extern: {
+			AstPrototype *proto = parse_extern(parser);
+			lb_extern(lb, proto);
+		} break;
+
+		default: {
+			if (parser->token->type == TokenType_Ascii && parser->token->ascii == ';') {
+				parser_advance(parser);
+			} else {
+				if (definitions.len > 0) {
+					lb_jit_add_definitions_parallel(lb, definitions.ptr, definitions.len, jobs, options->dump_ir, allocator);
+					gb_array_clear(&definitions);
+				}
+				// NOTE(khvorov) Expressions are thrown away after being run
+				gbTempArenaMemory temp_memory = gb_temp_arena_memory_begin(&parser->arena);
+				AstPoolMark ast_mark = ast_pool_mark(&parser->ast);
+				AstFunction *fun = parse_top_level_expr(parser);
+				run_expression(lb, fun);
+				ast_pool_reset(&parser->ast, ast_mark);
+				gb_temp_arena_memory_end(temp_memory);
+			}
+		} break;
+		}
+	}
+
+	if (definitions.len > 0) {
+		lb_jit_add_definitions_parallel(lb, definitions.ptr, definitions.len, jobs, options->dump_ir, allocator);
+	}
+	gb_array_free(&definitions);
+}
+
+int
+main(int argc, char **argv) {
+
+	Options options = { 0 };
+	options.opt_level = 1;
+	gbAllocator heap_allocator = gb_heap_allocator();
+
+	GB_ASSERT(keyword_table_check());
+	symbol_table_init(&global_symbols, heap_allocator);
+
+	gbDynamicArray input_paths = { 0 };
+	gb_array_init(&input_paths, heap_allocator, sizeof(char *));
+	for (int arg_index = 1; arg_index < argc; arg_index += 1) {
+		char *arg = argv[arg_index];
+		if (gb_strcmp(arg, "-dump-ir") == 0) {
+			options.dump_ir = true;
+		} else if (gb_strcmp(arg, "-mmap") == 0) {
+			options.mmap_input = true;
+		} else if (gb_strcmp(arg, "-bench-lex") == 0) {
+			options.bench_lex = true;
+		} else if (gb_strcmp(arg, "-bench-tokens") == 0) {
+			options.bench_tokens = true;
+		} else if (gb_strcmp(arg, "-bench-float") == 0) {
+			options.bench_float = true;
+		} else if (gb_strcmp(arg, "-bench-parse") == 0) {
+			options.bench_parse = true;
+		} else if (gb_strcmp(arg, "-bench-htab") == 0) {
+			options.bench_htab = true;
+		} else if (gb_strcmp(arg, "-bench-hash") == 0) {
+			options.bench_hash = true;
+		} else if (gb_strcmp(arg, "-bench-jobs") == 0) {
+			options.bench_jobs = true;
+		} else if (gb_strcmp(arg, "-lex-first") == 0) {
+			options.lex_first = true;
+		} else if (arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3' && arg[3] == '\0') {
+			options.opt_level = arg[2] - '0';
+		} else if (gb_strcmp(arg, "-time-passes") == 0) {
+			options.time_passes = true;
+		} else if (gb_strcmp(arg, "-tier") == 0) {
+			options.tier = true;
+		} else if (gb_strcmp(arg, "-cache") == 0 && arg_index + 1 < argc) {
+			arg_index += 1;
+			options.cache_dir = argv[arg_index];
+		} else if (gb_strcmp(arg, "-jobs") == 0 && arg_index + 1 < argc) {
+			arg_index += 1;
+			options.jobs = gb_str_to_i64(argv[arg_index], 0, 10);
+			GB_ASSERT_MSG(options.jobs >= 1, "-jobs needs a positive number of threads");
+		} else {
+			gb_array_append(&input_paths, &arg);
+		}
+	}
+	if (input_paths.len == 0) {
+		char *stdin_path = "-";
+		gb_array_append(&input_paths, &stdin_path);
+	}
+
+	if (options.bench_parse) {
+		bench_parse(heap_allocator);
+		return 0;
+	}
+
+	if (options.bench_htab) {
+		bench_htab(heap_allocator);
+		return 0;
+	}
+
+	if (options.bench_hash) {
+		bench_hash(heap_allocator);
+		return 0;
+	}
+
+	// NOTE(khvorov) One thread per logical processor unless -jobs says otherwise
+	if (options.bench_jobs) {
+		isize worker_count = options.jobs;
+		if (worker_count == 0) {
+			gbAffinity affinity;
+			gb_affinity_init(&affinity);
+			worker_count = affinity.core_count;
+			gb_affinity_destroy(&affinity);
+		}
+		bench_jobs(worker_count, heap_allocator);
+		return 0;
+	}
+
+	if (options.bench_lex || options.bench_tokens || options.bench_float) {
+		JobSystem job_system;
+		JobSystem *jobs = 0;
+		if (options.jobs > 0) {
+			jobs = &job_system;
+			job_system_init(jobs, options.jobs, heap_allocator);
+		}
+		for (isize path_index = 0; path_index < input_paths.len; path_index += 1) {
+			char *path = *(char **)gb_array_get(&input_paths, path_index);
+			if (options.bench_lex) {
+				bench_lex(path, heap_allocator);
+			}
+			if (options.bench_tokens) {
+				bench_tokens(path, jobs, heap_allocator);
+			}
+			if (options.bench_float) {
+				bench_float(path, heap_allocator);
+			}
+		}
+		if (jobs != 0) {
+			job_system_destroy(jobs);
+		}
+		return 0;
+	}
+
+	AstParser parser = { 0 };
+	parser_init(&parser, heap_allocator);
+
+	gbHashTable function_protos = { 0 };
+	gb_htab_init(&function_protos, heap_allocator, sizeof(Symbol), sizeof(AstPrototype *), symbol_hash, symbol_cmp);
+
+	LLVMBackend llvm_backend;
+	lb_init(&llvm_backend, LLVMGetGlobalContext(), heap_allocator);
+	llvm_backend.ast = &parser.ast;
+	llvm_backend.function_protos = &function_protos;
+	llvm_backend.opt_level = options.opt_level;
+
+	// NOTE(khvorov) LLVM keeps the timings and prints them on shutdown
+	if (options.time_passes) {
+		char const *llvm_args[] = { argv[0], "-time-passes" };
+		LLVMParseCommandLineOptions(gb_count_of(llvm_args), llvm_args, 0);
+	}
+
+	lb_jit_init(&llvm_backend);
+
+	// NOTE(khvorov) LLVM's pass timers are not meant to be shared between threads
+	GB_ASSERT_MSG(!options.time_passes || (!options.tier && options.jobs == 0), "-time-passes cannot be used with -tier or -jobs");
+	Tiering tiering;
+	if (options.tier) {
+		tier_init(&tiering, &llvm_backend, heap_allocator);
+	}
+
+	JobSystem jobs;
+	if (options.jobs > 0) {
+		job_system_init(&jobs, options.jobs, heap_allocator);
+	}
+
+	// NOTE(khvorov) Tier 0 code points at this process's counters and the
+	// parallel codegen optimizes whole batches at once, neither can be cached
+	GB_ASSERT_MSG(options.cache_dir == 0 || (!options.tier && options.jobs == 0), "-cache cannot be used with -tier or -jobs");
+	CompileCache cache;
+	if (options.cache_dir != 0) {
+		compile_cache_init(&cache, options.cache_dir, options.opt_level, heap_allocator);
+		llvm_backend.cache = &cache;
+	}
+
+	for (isize path_index = 0; path_index < input_paths.len; path_index += 1) {
+		char *path = *(char **)gb_array_get(&input_paths, path_index);
+
+		b32 is_stdin = gb_strcmp(path, "-") == 0;
+		Lexer lexer = { 0 };
+		gbFile file = { 0 };
+		b32 file_opened = false;
+		TokenStream stream = { 0 };
+		gbFileContents contents = { 0 };
+		SourceMapping mapping = { 0 };
+		b32 use_stream = options.lex_first && !is_stdin;
+
+		if (use_stream && !options.mmap_input) {
+			contents = gb_file_read_contents(heap_allocator, false, path);
+			if (contents.data == 0 && !gb_file_exists(path)) {
+				gb_printf_err("could not open %s\n", path);
+				return 1;
+			}
+			lexer.input.ptr = contents.data;
+			lexer.input.len = contents.size;
+		} else if (options.mmap_input && !is_stdin) {
+			if (!source_map_file(&mapping, path)) {
+				gb_printf_err("could not map %s\n", path);
+				return 1;
+			}
+			lexer_init_mapped(&lexer, &mapping);
+		} else {
+			gbFile *input_file = &file;
+			if (is_stdin) {
+				input_file = gb_file_get_standard(gbFileStandard_Input);
+			} else if (gb_file_open(&file, path) == gbFileError_None) {
+				file_opened = true;
+			} else {
+				gb_printf_err("could not open %s\n", path);
+				return 1;
+			}
+			lexer_init(&lexer, input_file, heap_allocator);
+		}
+
+		if (use_stream) {
+			token_stream_init(&stream, lexer.input, heap_allocator);
+			if (options.jobs > 0) {
+				token_stream_lex_parallel(&stream, &jobs, heap_allocator);
+			} else {
+				token_stream_lex(&stream);
+			}
+			parser_set_stream(&parser, &stream);
+		} else {
+			parser_set_lexer(&parser, &lexer);
+		}
+		// NOTE(khvorov) Standard input can be someone typing, every item has to
+		// run as soon as it is read
+		if (options.jobs > 0 && !is_stdin) {
+			run_top_level_items_parallel(&llvm_backend, &parser, &jobs, &options, heap_allocator);
+		} else {
+			run_top_level_items(&llvm_backend, &parser, &options);
+		}
+
+		if (use_stream) {
+			token_stream_destroy(&stream);
+		}
+		if (contents.data != 0) {
+			gb_file_free_contents(&contents);
+		}
+		source_unmap_file(&mapping);
+		lexer_destroy(&lexer);
+		if (file_opened) {
+			gb_file_close(&file);
+		}
+	}
+
+	if (options.tier) {
+		tier_destroy(&tiering);
+	}
+
+	if (options.jobs > 0) {
+		job_system_destroy(&jobs);
+	}
+
+	if (options.cache_dir != 0) {
+		compile_cache_report(&cache);
+		compile_cache_destroy(&cache);
+	}
+
+	if (options.time_passes) {
+		LLVMDisposeExecutionEngine(llvm_backend.engine);
+		LLVMShutdown();
+	}
 
 	return 0;
 }